@@ -14,35 +14,65 @@
 #include "assets/tilemaps.h"
 #include "assets/tilesets.h"
 
-#include <soa_entities_sdl2.h>
+#include <soa_components_sdl2.h>
+#include <soa_components_spatial.h>
+#include <soa_components_vertex.h>
 #include <soa_entities_tds.h>
 #include <soa_entities_vertex.h>
 #include <soa_systems_animation.h>
 #include <soa_systems_bullet.h>
 #include <soa_systems_camera.h>
 #include <soa_systems_despawn.h>
+#include <soa_systems_explosion.h>
 #include <soa_systems_movement.h>
 #include <soa_systems_physics.h>
 #include <soa_systems_sdl2.h>
+#include <soa_systems_spatial.h>
 #include <soa_systems_tilemap.h>
 #include <soa_systems_transform.h>
 #include <soa_systems_vertex.h>
 
+/* Render queue layers, drawn from the lowest up. */
+enum {
+	RENDER_LAYER_ACTORS,
+	RENDER_LAYER_OUTLINES,
+	RENDER_LAYER_BULLETS,
+	RENDER_LAYER_OVERLAY,
+};
+
 typedef struct SDL_SceneData {
 	SDL_Texture *tileset1_texture;
+	soa_tilemap_chunks tilemap_chunks;
 	f32v2 texture_size;
 	i32v2 tile_size;
 	soa_timer_t gameplay_timer;
 	soa_character player;
 	soa_character monster;
+	soa_prop barrel;
 	soa_bullet bullet;
 	soa_slot_t player_slot;
+	soa_spatial_grid player_grid;
+	soa_spatial_grid monster_grid;
+	soa_spatial_grid barrel_grid;
+	soa_contact2 contacts;
+	soa_position2 render_position;
+	soa_position2 render_old_position;
+	soa_render_queue render_queue;
+	soa_render_stats render_stats;
+	soa_triangle_index triangle_index;
 	f32v2 camera;
 	soa_vertex_3d vertex_3d;
-	soa_sdl2_vertex_array sdl2_vertex_array;
 	bool render_3d;
 } SDL_SceneData;
 
+/* The map origin is the camera, so the tiles go back to f32 without losing the offsets. */
+static void update_map_position(
+	soa_prop *prop,
+	const f32 tile_size)
+{
+	soa_apply_camera_2d_lwc(&prop->position, prop->_ent.count, (lwc32v2){ 0 }, tile_size, &prop->map_position);
+}
+
 static void load_map_objects(
 	SDL_SceneData *data,
 	const tilemap_t *tilemap,
@@ -69,11 +99,6 @@ static void load_map_objects(
 						.position = tile_position_to_position(tile_position, tile_size),
 						.size = entity_size,
 						.speed = 400.f,
-						.animation = {
-							.begin_frame = player_animation.begin_tile_frame,
-							.end_frame = player_animation.end_tile_frame,
-							.frame_time = player_animation.frame_time,
-						},
 					});
 					break;
 				}
@@ -82,12 +107,19 @@ static void load_map_objects(
 						.position = tile_position_to_position(tile_position, tile_size),
 						.size = entity_size,
 						.speed = 200.f,
+						.weight = 70.f,
 						.health = 100.f,
-						.animation = {
-							.begin_frame = monster_animation.begin_tile_frame,
-							.end_frame = monster_animation.end_tile_frame,
-							.frame_time = monster_animation.frame_time,
-						},
+					});
+					break;
+				}
+				case TILEMAP_OBJECT_BARREL: {
+					/* the large world tiles are the map tiles */
+					soa_prop_new1(&data->barrel, &(const soa_prop_desc_t) {
+						.position = { .x = { tile_position.x, 0.f }, .y = { tile_position.y, 0.f } },
+						.size = entity_size,
+						.weight = 150.f,
+						.health = 50.f,
+						.damage = 150.f,
 					});
 					break;
 				}
@@ -116,15 +148,24 @@ static void game_init(
 	data->texture_size = texture_size;
 	data->tile_size = (i32v2) { 32, 32 };
 	data->gameplay_timer = soa_timer_init();
+	soa_timer_set_max_steps(&data->gameplay_timer, 4);
 	data->player = (soa_character)SOA_ENTITY_WITH_TOMBSTONE;
 	data->monster = (soa_character)SOA_ENTITY_WITH_TOMBSTONE;
+	data->barrel = (soa_prop)SOA_ENTITY_WITH_TOMBSTONE;
 	data->bullet = (soa_bullet)SOA_ENTITY_WITH_TOMBSTONE;
 	data->player_slot = (soa_slot_t) { 0 };
 	data->vertex_3d = (soa_vertex_3d)SOA_ENTITY_ZERO;
-	data->sdl2_vertex_array = (soa_sdl2_vertex_array)SOA_ENTITY_ZERO;
 	data->render_3d = false;
+	soa_init_render_queue(&data->render_queue);
+
+	soa_init_animation_clock(&data->player.animation, &player_animation);
+	soa_init_animation_clock(&data->monster.animation, &monster_animation);
+	soa_init_animation_clock(&data->barrel.animation, &barrel_animation);
+	soa_init_animation_clock(&data->bullet.animation, &bullet_animation);
 
 	load_map_objects(data, &level1_map, &tilemap_encoding1);
+	update_map_position(&data->barrel, (f32)data->tile_size.width);
+	soa_init_tilemap_chunks(&data->tilemap_chunks, &level1_map, data->tile_size, app->renderer);
 
 	soa_calculate_tilemap_collision_buffer(&level1_map, &tilemap_encoding1, &tile_properties1);
 }
@@ -134,6 +175,7 @@ static void game_fini(
 	SDL_SceneData *data)
 {
 	(void)app;
+	soa_fini_tilemap_chunks(&data->tilemap_chunks);
 	SDL_DestroyTexture(data->tileset1_texture);
 	soa_timer_fini(&data->gameplay_timer);
 }
@@ -156,12 +198,8 @@ static void fire_bullet(
 			.destination = world_mouse_position,
 			.size = { data->tile_size.x, data->tile_size.y },
 			.speed = 600.f,
+			.weight = 10.f,
 			.damage = 50.f,
-			.animation = {
-				.begin_frame = bullet_animation.begin_tile_frame,
-				.end_frame = bullet_animation.end_tile_frame,
-				.frame_time = bullet_animation.frame_time,
-			},
 		});
 	}
 }
@@ -180,12 +218,8 @@ static void spawn_monsters(
 			.position = monster_position,
 			.size = { data->tile_size.x, data->tile_size.y },
 			.speed = 200.f,
+			.weight = 70.f,
 			.health = 100.f,
-			.animation = {
-				.begin_frame = monster_animation.begin_tile_frame,
-				.end_frame = monster_animation.end_tile_frame,
-				.frame_time = monster_animation.frame_time,
-			},
 		});
 	}
 }
@@ -203,6 +237,9 @@ static void game_handle_sdl_event(
 	static bool move_down = false;
 
 	switch (event->type) {
+	case SDL_RENDER_TARGETS_RESET:
+		soa_invalidate_tilemap_chunks(&data->tilemap_chunks);
+		break;
 	case SDL_KEYDOWN:
 		if (event->key.keysym.scancode == SDL_SCANCODE_Z)
 			data->render_3d = !data->render_3d;
@@ -210,6 +247,11 @@ static void game_handle_sdl_event(
 		if (event->key.keysym.scancode == SDL_SCANCODE_SPACE)
 			spawn_monsters(data, (f32rect){ 0.f, 0.f, 1024.f, 1024.f }, 10);
 
+		if (event->key.keysym.scancode == SDL_SCANCODE_R)
+			SDL_Log("render queue: %u commands, %u draws, %u texture changes, %u blend mode changes",
+				data->render_stats.command_count, data->render_stats.draw_count,
+				data->render_stats.texture_changes, data->render_stats.blend_mode_changes);
+
 		if (event->key.keysym.scancode == SDL_SCANCODE_A)
 			move_left = true;
 		if (event->key.keysym.scancode == SDL_SCANCODE_D)
@@ -257,6 +299,32 @@ static void game_handle_sdl_event(
 
 }
 
+static void explode_on_something(
+	soa_health *s_health,
+	const soa_spatial_grid *s_grid,
+	const soa_position2 *x_position,
+	const soa_damage *x_damage,
+	const soa_slot_t *explosion_slots,
+	const usize explosion_count,
+	const f32 radius)
+{
+	soa_slot_t hit_explosions[SOA_LIMIT];
+	soa_slot_t hit_somethings[SOA_LIMIT];
+	f32 hit_distances[SOA_LIMIT];
+
+	/* the query stops when the hit buffers are full, resume from there */
+	usize done = 0;
+	while (done < explosion_count) {
+		usize hit_count;
+		usize query_count;
+		soa_find_in_radius_in_spatial_grid(x_position, explosion_slots + done, explosion_count - done, radius,
+			s_grid, SOA_LIMIT, hit_explosions, hit_somethings, hit_distances, &hit_count, &query_count);
+		soa_explosion_damages_something(s_health, x_damage, radius,
+			hit_somethings, hit_explosions, hit_distances, hit_count);
+		done += query_count;
+	}
+}
+
 static void game_tick(
 	SDL_App *app,
 	SDL_SceneData *data,
@@ -265,17 +333,22 @@ static void game_tick(
 {
 	soa_character *player = &data->player;
 	soa_character *monster = &data->monster;
+	soa_prop *barrel = &data->barrel;
 	soa_bullet *bullet = &data->bullet;
 	const soa_slot_t player_slot = data->player_slot;
 	soa_vertex_3d *vertex_3d = &data->vertex_3d;
-	soa_sdl2_vertex_array *sdl2_vertex_array = &data->sdl2_vertex_array;
 
-	/* update gameplay at 60hz */
+	/* update gameplay at 60hz, rendering interpolates between the last two steps */
 	soa_timer_t *gameplay_timer = &data->gameplay_timer;
 	soa_timer_tick(gameplay_timer, tick_dt);
 	while (soa_timer_do_frame(gameplay_timer, 1.0 / 60.0)) {
 		const f32seconds dt = { (f32)soa_timer_delta_seconds(gameplay_timer) };
 
+		soa_backup_position2(&player->position, &player->old_position, player->_ent.count);
+		soa_backup_position2(&monster->position, &monster->old_position, monster->_ent.count);
+		soa_backup_position2(&bullet->position, &bullet->old_position, bullet->_ent.count);
+		soa_backup_lwc_position2(&barrel->position, &barrel->old_position, barrel->_ent.count);
+
 		soa_reset_velocity(&player->velocity, player->_ent.count);
 		soa_movement_to_velocity(&player->movement, &player->speed, &player->velocity, player->_ent.count);
 		soa_multiply_velocity_by_future_tile_speed(&player->position, &player->velocity, player_slot, &level1_map, data->tile_size, dt);
@@ -283,22 +356,40 @@ static void game_tick(
 		soa_progress_animation_if_moving(&player->animation, &player->velocity, player->_ent.count, dt);
 		soa_fetch_tileset_animation(&player->animation, &player->clip, player->_ent.count, &tileset1);
 
-		soa_reset_velocity(&monster->velocity, monster->_ent.count);
-		soa_follow_one_target(&monster->movement, &monster->position, &monster->speed, monster->_ent.count, &player->position, player_slot);
-		soa_movement_to_velocity(&monster->movement, &monster->speed, &monster->velocity, monster->_ent.count);
-		soa_apply_forwards_velocity(&monster->position, &monster->velocity, monster->_ent.count, dt);
-		soa_progress_animation_if_moving(&monster->animation, &monster->velocity, monster->_ent.count, dt);
+		soa_build_spatial_grid(&player->position, &player->_ent, 256.f, &data->player_grid);
+
+		soa_follow_nearest_target(&monster->movement, &monster->position, &monster->speed, monster->_ent.count, &player->position, &data->player_grid);
+		soa_build_spatial_grid(&monster->position, &monster->_ent, (f32)data->tile_size.width, &data->monster_grid);
+		soa_separate_from_neighbours(&monster->movement, &monster->position, &monster->speed, monster->_ent.count, &data->monster_grid, (f32)data->tile_size.width);
+		soa_move_and_animate(&monster->position, &monster->velocity, &monster->animation, &monster->movement, &monster->speed, monster->_ent.count, dt);
 		soa_fetch_tileset_animation(&monster->animation, &monster->clip, monster->_ent.count, &tileset1);
 
+		/* the player weighs nothing, so it pushes without being pushed */
+		const f32 body_radius = (f32)data->tile_size.width;
+		soa_build_spatial_grid(&monster->position, &monster->_ent, body_radius, &data->monster_grid);
+		soa_build_spatial_grid(&barrel->map_position, &barrel->_ent, body_radius, &data->barrel_grid);
+		soa_push_apart(&data->contacts, &monster->position, &monster->weight, &monster->knockback, &data->monster_grid,
+			&monster->position, &monster->weight, &monster->knockback, &data->monster_grid, body_radius, 4, dt);
+		soa_push_apart(&data->contacts, &monster->position, &monster->weight, &monster->knockback, &data->monster_grid,
+			&barrel->map_position, &barrel->weight, &barrel->knockback, &data->barrel_grid, body_radius, 4, dt);
+		soa_push_apart(&data->contacts, &barrel->map_position, &barrel->weight, &barrel->knockback, &data->barrel_grid,
+			&barrel->map_position, &barrel->weight, &barrel->knockback, &data->barrel_grid, body_radius, 4, dt);
+		soa_push_apart(&data->contacts, &player->position, &player->weight, &player->knockback, &data->player_grid,
+			&monster->position, &monster->weight, &monster->knockback, &data->monster_grid, body_radius, 4, dt);
+		soa_push_apart(&data->contacts, &player->position, &player->weight, &player->knockback, &data->player_grid,
+			&barrel->map_position, &barrel->weight, &barrel->knockback, &data->barrel_grid, body_radius, 4, dt);
+		soa_apply_knockback(&monster->position, &monster->knockback, monster->_ent.count, 8.f, dt);
+		soa_apply_knockback_lwc(&barrel->position, &barrel->knockback, barrel->_ent.count, 8.f, dt);
+		soa_renormalize_lwc_position2(&barrel->position, barrel->_ent.count, body_radius);
+		update_map_position(barrel, body_radius);
+
 		soa_slot_t despawn_monster_slots[monster->_ent.count];
 		usize despawn_monster_slot_count;
 		soa_get_dead_despawn_slots(&monster->health, monster->_ent.count, despawn_monster_slots, &despawn_monster_slot_count);
 		soa_character_free(monster, despawn_monster_slots, despawn_monster_slot_count);
 
-		soa_reset_velocity(&bullet->velocity, bullet->_ent.count);
 		soa_forward_movement_from_rotation(&bullet->movement, &bullet->rotation, bullet->_ent.count);
-		soa_movement_to_velocity(&bullet->movement, &bullet->speed, &bullet->velocity, bullet->_ent.count);
-		soa_apply_forwards_velocity(&bullet->position, &bullet->velocity, bullet->_ent.count, dt);
+		soa_move(&bullet->position, &bullet->velocity, &bullet->movement, &bullet->speed, bullet->_ent.count, dt);
 		soa_fetch_tileset_animation(&bullet->animation, &bullet->clip, bullet->_ent.count, &tileset1);
 
 		soa_slot_t despawn_bullet_slots[bullet->_ent.count];
@@ -307,6 +398,12 @@ static void game_tick(
 			10.f, despawn_bullet_slots, &despawn_bullet_slot_count);
 		soa_bullet_free(bullet, despawn_bullet_slots, despawn_bullet_slot_count);
 
+		soa_raycast_tilemap(&bullet->position, &bullet->movement, bullet->_ent.count,
+			(f32)data->tile_size.width, &level1_map, data->tile_size, &bullet->wall_hit);
+		soa_get_raycast_blocked_despawn_slots(&bullet->wall_hit, &bullet->speed, bullet->_ent.count,
+			dt, despawn_bullet_slots, &despawn_bullet_slot_count);
+		soa_bullet_free(bullet, despawn_bullet_slots, despawn_bullet_slot_count);
+
 		const usize collided_max = bullet->_ent.count;
 		soa_slot_t collided_monsters[collided_max];
 		soa_slot_t collided_bullets[collided_max];
@@ -314,50 +411,104 @@ static void game_tick(
 		soa_detect_bullet_collisions_with_something(&monster->position, &monster->size, monster->_ent.count,
 			&bullet->position, bullet->_ent.count, collided_monsters, collided_bullets, &collided_count);
 		soa_bullet_damages_something(&monster->health, &bullet->damage, collided_monsters, collided_bullets, collided_count);
+		soa_bullet_knocks_back_something(&monster->knockback, &monster->weight, &bullet->velocity, &bullet->weight,
+			collided_monsters, collided_bullets, collided_count);
 		soa_bullet_free(bullet, collided_bullets, collided_count);
+
+		soa_slot_t collided_barrels[collided_max];
+		soa_detect_bullet_collisions_with_something(&barrel->map_position, &barrel->size, barrel->_ent.count,
+			&bullet->position, bullet->_ent.count, collided_barrels, collided_bullets, &collided_count);
+		soa_bullet_damages_something(&barrel->health, &bullet->damage, collided_barrels, collided_bullets, collided_count);
+		soa_bullet_knocks_back_something(&barrel->knockback, &barrel->weight, &bullet->velocity, &bullet->weight,
+			collided_barrels, collided_bullets, collided_count);
+		soa_bullet_free(bullet, collided_bullets, collided_count);
+
+		soa_fetch_tileset_animation(&barrel->animation, &barrel->clip, barrel->_ent.count, &tileset1);
+
+		/* barrels damaged by an explosion go off on the next tick */
+		soa_slot_t exploding_barrels[barrel->_ent.count];
+		usize exploding_barrel_count;
+		soa_get_exploding_slots(&barrel->health, &barrel->_ent, exploding_barrels, &exploding_barrel_count);
+		if (exploding_barrel_count > 0) {
+			const f32 explosion_radius = 3.f * (f32)data->tile_size.width;
+			soa_build_spatial_grid(&monster->position, &monster->_ent, (f32)data->tile_size.width, &data->monster_grid);
+			soa_build_spatial_grid(&barrel->map_position, &barrel->_ent, (f32)data->tile_size.width, &data->barrel_grid);
+			explode_on_something(&monster->health, &data->monster_grid, &barrel->map_position, &barrel->damage,
+				exploding_barrels, exploding_barrel_count, explosion_radius);
+			explode_on_something(&barrel->health, &data->barrel_grid, &barrel->map_position, &barrel->damage,
+				exploding_barrels, exploding_barrel_count, explosion_radius);
+			soa_prop_free(barrel, exploding_barrels, exploding_barrel_count);
+		}
 	}
 
+	const f32 alpha = (f32)soa_timer_alpha(gameplay_timer);
+	soa_position2 *render_position = &data->render_position;
+
 	/* old rendering */
-	const f32v2 center = soa_get_one_position2(&player->position, player_slot);
+	soa_interpolate_position2(&player->old_position, &player->position, player->_ent.count, alpha, render_position);
+	const f32v2 center = soa_get_one_position2(render_position, player_slot);
 	const f32v2 camera = camera_center_offset(viewport, center);
-	const f32v3 camera_3d = { .x = camera.x, .y = 20.f, .z = camera.y };
+	/* Far enough that the 60 degree field of view shows the z = 0 plane at the
+	 * scale of the 2D view. */
+	const f32v3 camera_3d = { .x = center.x, .y = center.y, .z = -0.866f * viewport.height };
 	data->camera = camera;
 
-	soa_draw_tilemap(&level1_map, &tilemap_encoding1, &tileset1,
-		data->tile_size, app->renderer, data->tileset1_texture, camera);
-	soa_draw_sprite(&player->position, &player->size, &player->clip, player->_ent.count,
-		app->renderer, data->tileset1_texture, camera);
-	// soa_draw_sprite(&monster->position, &monster->size, &monster->clip, monster->_ent.count,
-	//	app->renderer, data->tileset1_texture, camera);
-	soa_draw_rect(&monster->position, &monster->size, monster->_ent.count,
-		app->renderer, camera);
-	soa_draw_sprite_rotated(&bullet->position, &bullet->rotation, &bullet->size, &bullet->clip, bullet->_ent.count,
-		app->renderer, data->tileset1_texture, camera);
-	// soa_draw_tilemap_collision_buffer(&level1_map, data->tile_size, data->renderer, camera);
+	soa_bake_tilemap_chunks(&data->tilemap_chunks, &level1_map, &tilemap_encoding1, &tileset1,
+		app->renderer, data->tileset1_texture);
+	soa_draw_tilemap_chunks(&data->tilemap_chunks, &level1_map, &tilemap_encoding1, &tileset1,
+		app->renderer, data->tileset1_texture, camera, viewport);
+	soa_render_queue *render_queue = &data->render_queue;
+	soa_begin_render_queue(render_queue, app->renderer);
+	soa_queue_sprite(render_position, &player->size, &player->clip, player->_ent.count,
+		camera, viewport, RENDER_LAYER_ACTORS, data->tileset1_texture, SDL_BLENDMODE_BLEND, data->texture_size, render_queue);
+	/* barrels leave large world coordinates here, already relative to the camera */
+	const f32 tile_size = (f32)data->tile_size.width;
+	const lwc32v2 lwc_camera = position_to_lwc_position(camera, tile_size);
+	soa_apply_camera_2d_lwc(&barrel->old_position, barrel->_ent.count, lwc_camera, tile_size, &data->render_old_position);
+	soa_apply_camera_2d_lwc(&barrel->position, barrel->_ent.count, lwc_camera, tile_size, render_position);
+	soa_interpolate_position2(&data->render_old_position, render_position, barrel->_ent.count, alpha, render_position);
+	soa_queue_sprite(render_position, &barrel->size, &barrel->clip, barrel->_ent.count,
+		(f32v2){ 0.f, 0.f }, viewport, RENDER_LAYER_ACTORS, data->tileset1_texture, SDL_BLENDMODE_BLEND, data->texture_size, render_queue);
+	soa_interpolate_position2(&monster->old_position, &monster->position, monster->_ent.count, alpha, render_position);
+	// soa_queue_sprite(render_position, &monster->size, &monster->clip, monster->_ent.count,
+	//	camera, viewport, RENDER_LAYER_ACTORS, data->tileset1_texture, SDL_BLENDMODE_BLEND, data->texture_size, render_queue);
+	soa_queue_rect(render_position, &monster->size, &monster->color, monster->_ent.count,
+		camera, viewport, RENDER_LAYER_OUTLINES, SDL_BLENDMODE_BLEND, render_queue);
+	soa_interpolate_position2(&bullet->old_position, &bullet->position, bullet->_ent.count, alpha, render_position);
+	soa_queue_sprite_rotated(render_position, &bullet->rotation, &bullet->size, &bullet->clip, bullet->_ent.count,
+		camera, viewport, RENDER_LAYER_BULLETS, data->tileset1_texture, SDL_BLENDMODE_BLEND, data->texture_size, render_queue);
+	// soa_queue_tilemap_collision_buffer(&level1_map, data->tile_size, camera, viewport, RENDER_LAYER_OVERLAY, render_queue);
+	soa_submit_render_queue(render_queue);
+	data->render_stats = render_queue->stats;
 
 	/* new rendering */
 	soa_clear(&vertex_3d->_ent);
-	soa_clear(&sdl2_vertex_array->_ent);
 
 	soa_make_cube(&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, &vertex_3d->_ent,
 			(f32v3){ 100.f, 100.f, 0.f }, 100.f);
+	soa_interpolate_position2(&monster->old_position, &monster->position, monster->_ent.count, alpha, render_position);
 	if (!data->render_3d) {
-		soa_make_sprite_vertices(&monster->position, &monster->rotation, &monster->size, &monster->clip, &monster->color, monster->_ent.count,
+		soa_make_sprite_vertices(render_position, &monster->rotation, &monster->size, &monster->clip, &monster->color, monster->_ent.count,
 			&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, &vertex_3d->_ent,
 			data->texture_size);
 		soa_apply_camera_2d(&vertex_3d->position, vertex_3d->_ent.count,
 			camera);
+		soa_sort_quads_by_y(&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord,
+			vertex_3d->_ent.count);
+		soa_draw_quads_raw(&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, vertex_3d->_ent.count,
+			app->renderer, data->tileset1_texture);
 	} else {
-		soa_make_sprite_vertices_3d(&monster->position, &monster->rotation, &monster->size, &monster->clip, &monster->color, monster->_ent.count,
+		soa_make_sprite_vertices_3d(render_position, &monster->rotation, &monster->size, &monster->clip, &monster->color, monster->_ent.count,
 			&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, &vertex_3d->_ent,
 			data->texture_size);
 		soa_apply_camera_3d(&vertex_3d->position, vertex_3d->_ent.count,
 			camera_3d, viewport);
+		soa_clip_triangles_3d(&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, &vertex_3d->_ent,
+			&data->triangle_index);
+		soa_sort_triangles_by_depth(&vertex_3d->position, &data->triangle_index);
+		soa_draw_triangles_raw(&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, vertex_3d->_ent.count,
+			&data->triangle_index, app->renderer, data->tileset1_texture);
 	}
-	soa_make_sdl2_vertex(&vertex_3d->position, &vertex_3d->color, &vertex_3d->texcoord, vertex_3d->_ent.count,
-		&sdl2_vertex_array->vertex, &sdl2_vertex_array->_ent);
-	soa_draw_geometry(&sdl2_vertex_array->vertex, sdl2_vertex_array->_ent.count,
-		app->renderer, data->tileset1_texture);
 }
 
 SDL_SceneDesc export_sdl_scene(
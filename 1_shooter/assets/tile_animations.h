@@ -19,3 +19,9 @@ static const tile_animation_t bullet_animation = {
 	.end_tile_frame = TILEMAP_TILE_BULLET,
 	.frame_time.seconds = 1.f / 30.f,
 };
+
+static const tile_animation_t barrel_animation = {
+	.begin_tile_frame = TILEMAP_TILE_BARREL,
+	.end_tile_frame = TILEMAP_TILE_BARREL,
+	.frame_time.seconds = 1.f / 30.f,
+};
@@ -1,4 +1,5 @@
 #include <SDL.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -24,12 +25,20 @@ typedef struct data_color      { u8 r, g, b, a ;    } data_color;
 typedef struct data_size       { f32 width, height; } data_size;
 typedef struct data_sdl_vertex { SDL_Vertex val;    } data_sdl_vertex;
 
+/* Intrusive links of an entity into the bucket list of a spatial_hash. */
+typedef struct data_grid_link {
+	u32 bucket;
+	u32 prev;
+	u32 next;
+} data_grid_link;
+
 typedef struct entity_square {
-	entity         _ent;
-	data_position *position;
-	data_speed    *speed;
-	data_color    *color;
-	data_size     *size;
+	entity          _ent;
+	data_position  *position;
+	data_speed     *speed;
+	data_color     *color;
+	data_size      *size;
+	data_grid_link *grid_link;
 } entity_square;
 
 typedef struct entity_particle {
@@ -66,10 +75,11 @@ void instantiate_square(
 {
 	if (instantiate_should_resize(&square->_ent, out_slots, count))
 	{
-		square->position = realloc(square->position, sizeof(*square->position) * square->_ent.max);
-		square->speed    = realloc(square->speed,    sizeof(*square->speed)    * square->_ent.max);
-		square->color    = realloc(square->color,    sizeof(*square->color)    * square->_ent.max);
-		square->size     = realloc(square->size,     sizeof(*square->size)     * square->_ent.max);
+		square->position  = realloc(square->position,  sizeof(*square->position)  * square->_ent.max);
+		square->speed     = realloc(square->speed,     sizeof(*square->speed)     * square->_ent.max);
+		square->color     = realloc(square->color,     sizeof(*square->color)     * square->_ent.max);
+		square->size      = realloc(square->size,      sizeof(*square->size)      * square->_ent.max);
+		square->grid_link = realloc(square->grid_link, sizeof(*square->grid_link) * square->_ent.max);
 	}
 }
 
@@ -235,6 +245,159 @@ find_result find_rect_at_position(
 	return result;
 }
 
+/*
+ * Hashed uniform grid of rects, keyed by the cell of their top left corner.
+ * Entities are linked into bucket lists through their data_grid_link, so
+ * moving an entity to another cell is an unlink and a link. A pick only
+ * has to look at the cells a rect of the biggest size could start in.
+ */
+typedef struct spatial_hash {
+	f32   cell_size;
+	f32   max_width;
+	f32   max_height;
+	usize bucket_count;
+	u32  *head;
+} spatial_hash;
+
+static const u32 no_link = UINT32_MAX;
+
+u32 spatial_hash_cell_bucket(
+	const spatial_hash *hash,
+	const int           cell_x,
+	const int           cell_y)
+{
+	const u32 key = ((u32)cell_x * 73856093u) ^ ((u32)cell_y * 19349663u);
+	return key & (u32)(hash->bucket_count - 1);
+}
+
+u32 spatial_hash_bucket(
+	const spatial_hash *hash,
+	const f32           x,
+	const f32           y)
+{
+	const int cell_x = (int)floorf(x / hash->cell_size);
+	const int cell_y = (int)floorf(y / hash->cell_size);
+	return spatial_hash_cell_bucket(hash, cell_x, cell_y);
+}
+
+void spatial_hash_link(
+	spatial_hash   *hash,
+	data_grid_link *e_link,
+	const u32       e,
+	const u32       bucket)
+{
+	const u32 head = hash->head[bucket];
+	e_link[e] = (data_grid_link){ .bucket = bucket, .prev = no_link, .next = head };
+	if (head != no_link) e_link[head].prev = e;
+	hash->head[bucket] = e;
+}
+
+void spatial_hash_unlink(
+	spatial_hash   *hash,
+	data_grid_link *e_link,
+	const u32       e)
+{
+	const data_grid_link link = e_link[e];
+	if (link.prev != no_link) e_link[link.prev].next = link.next;
+	else                      hash->head[link.bucket] = link.next;
+	if (link.next != no_link) e_link[link.next].prev = link.prev;
+}
+
+void insert_into_spatial_hash(
+	spatial_hash        *hash,
+	data_grid_link      *e_link,
+	const data_position *e_position,
+	const data_size     *e_size,
+	const usize          first_entity,
+	const usize          entity_count)
+{
+	for (usize e = first_entity; e < entity_count; e += 1)
+	{
+		hash->max_width  = e_size[e].width  > hash->max_width  ? e_size[e].width  : hash->max_width;
+		hash->max_height = e_size[e].height > hash->max_height ? e_size[e].height : hash->max_height;
+	}
+
+	/* Keep at least two buckets per entity, growing relinks everything. */
+	usize link_from = first_entity;
+	if (hash->bucket_count < entity_count * 2)
+	{
+		usize bucket_count = hash->bucket_count ? hash->bucket_count : 1024;
+		while (bucket_count < entity_count * 2) bucket_count *= 2;
+		hash->head = realloc(hash->head, sizeof(*hash->head) * bucket_count);
+		hash->bucket_count = bucket_count;
+		for (usize b = 0; b < bucket_count; b += 1)
+		{
+			hash->head[b] = no_link;
+		}
+		link_from = 0;
+	}
+
+	for (usize e = link_from; e < entity_count; e += 1)
+	{
+		const u32 bucket = spatial_hash_bucket(hash, e_position[e].x, e_position[e].y);
+		spatial_hash_link(hash, e_link, (u32)e, bucket);
+	}
+}
+
+void update_spatial_hash(
+	spatial_hash        *hash,
+	data_grid_link      *e_link,
+	const data_position *e_position,
+	const usize          entity_count)
+{
+	for (usize e = 0; e < entity_count; e += 1)
+	{
+		const u32 bucket = spatial_hash_bucket(hash, e_position[e].x, e_position[e].y);
+		if (bucket != e_link[e].bucket) {
+			spatial_hash_unlink(hash, e_link, (u32)e);
+			spatial_hash_link(hash, e_link, (u32)e, bucket);
+		}
+	}
+}
+
+/* Same result as find_rect_at_position: the lowest slot containing the position. */
+find_result find_rect_at_position_in_spatial_hash(
+	const spatial_hash   *hash,
+	const data_grid_link *e_link,
+	const data_position  *e_position,
+	const data_size      *e_size,
+	const data_position   at_position)
+{
+	find_result result = { 0 };
+	if (hash->bucket_count == 0) return result;
+
+	const int min_x = (int)floorf((at_position.x - hash->max_width)  / hash->cell_size);
+	const int min_y = (int)floorf((at_position.y - hash->max_height) / hash->cell_size);
+	const int max_x = (int)floorf(at_position.x / hash->cell_size);
+	const int max_y = (int)floorf(at_position.y / hash->cell_size);
+
+	u32 found = no_link;
+	for (int cell_y = min_y; cell_y <= max_y; cell_y += 1)
+	{
+		for (int cell_x = min_x; cell_x <= max_x; cell_x += 1)
+		{
+			const u32 bucket = spatial_hash_cell_bucket(hash, cell_x, cell_y);
+			for (u32 e = hash->head[bucket]; e != no_link; e = e_link[e].next)
+			{
+				const bool inside_rect = {
+					at_position.x >= e_position[e].x &&
+					at_position.y >= e_position[e].y &&
+					at_position.x <= e_position[e].x + e_size[e].width &&
+					at_position.y <= e_position[e].y + e_size[e].height
+				};
+				if (inside_rect && e < found) found = e;
+			}
+		}
+	}
+
+	if (found != no_link) {
+		result.found = true;
+		result.found_slot = (slot){ found };
+	}
+
+	return result;
+}
+
 void generate_one_size_colored_triangle_sdl_vertex(
 	entity_vertex       *vertex,
 	const data_position *e_position,
@@ -301,6 +464,51 @@ void generate_shadowed_triangle_sdl_vertex_from_3d_text_mesh(
 
 }
 
+/* Writes the six vertices of an axis aligned quad. */
+static void write_quad_sdl_vertex(
+	SDL_Vertex     *out_vertex,
+	const f32       x1,
+	const f32       y1,
+	const f32       x2,
+	const f32       y2,
+	const SDL_Color color)
+{
+	out_vertex[0] = (SDL_Vertex){ .position = { x1, y1 }, .color = color };
+	out_vertex[1] = (SDL_Vertex){ .position = { x2, y1 }, .color = color };
+	out_vertex[2] = (SDL_Vertex){ .position = { x1, y2 }, .color = color };
+	out_vertex[3] = (SDL_Vertex){ .position = { x2, y1 }, .color = color };
+	out_vertex[4] = (SDL_Vertex){ .position = { x2, y2 }, .color = color };
+	out_vertex[5] = (SDL_Vertex){ .position = { x1, y2 }, .color = color };
+}
+
+/* Outlines as four one pixel thick quads on the inside of the rect, the same
+ * pixels SDL_RenderDrawRectF covers, so every rect goes out in one draw. */
+void generate_outline_rect_sdl_vertex(
+	entity_vertex       *vertex,
+	const data_position *e_position,
+	const data_size     *e_size,
+	const data_color    *e_color,
+	const usize          entity_count)
+{
+	const usize vertex_count = entity_count * 24;
+	slot *vertex_slots;
+	instantiate_vertex(vertex, &vertex_slots, vertex_count);
+
+	for (usize e = 0; e < entity_count; e += 1)
+	{
+		SDL_Vertex     *out   = &vertex->sdl_vertex[vertex_slots[e * 24].idx].val;
+		const f32       x1    = e_position[e].x;
+		const f32       y1    = e_position[e].y;
+		const f32       x2    = x1 + e_size[e].width;
+		const f32       y2    = y1 + e_size[e].height;
+		const SDL_Color color = { e_color[e].r, e_color[e].g, e_color[e].b, e_color[e].a };
+		write_quad_sdl_vertex(out +  0, x1,       y1,       x2,       y1 + 1.f, color);
+		write_quad_sdl_vertex(out +  6, x1,       y2 - 1.f, x2,       y2,       color);
+		write_quad_sdl_vertex(out + 12, x1,       y1 + 1.f, x1 + 1.f, y2 - 1.f, color);
+		write_quad_sdl_vertex(out + 18, x2 - 1.f, y1 + 1.f, x2,       y2 - 1.f, color);
+	}
+}
+
 void render_sdl_rect(
 	const data_position *e_position,
 	const data_size     *e_size,
@@ -415,8 +623,10 @@ int main(int argc, char* argv[])
 	data_color      red           = { 255, 50, 50, 255 };
 	data_color      green         = { 0, 255, 200, 255 };
 	data_color      yellow        = { 255, 255, 0, 255 };
+	spatial_hash    square_hash   = { .cell_size = 64.f };
 
 	spawn_squares_in_area(&square, 0, width, 0, height, 1024);
+	insert_into_spatial_hash(&square_hash, square.grid_link, square.position, square.size, 0, square._ent.count);
 
 	/* Game loop. */
 	bool running = true;
@@ -491,17 +701,26 @@ int main(int argc, char* argv[])
 
 		/* Gameplay. */
 		if (space) {
+			const usize first_square = square._ent.count;
 			spawn_squares_in_area(&square, 0, width, 0, height, 1024);
+			insert_into_spatial_hash(&square_hash, square.grid_link, square.position, square.size, first_square, square._ent.count);
 		}
 		if (click) {
-			find_result find = find_rect_at_position(square.position, square.size, square._ent.count, (data_position){ click_x, click_y });
+			find_result find = find_rect_at_position_in_spatial_hash(&square_hash, square.grid_link, square.position, square.size, (data_position){ click_x, click_y });
 			if (find.found) spawn_particles_on_entity(&particle, square.position, square.size, square.color, find.found_slot, 10240);
 		}
 		move_on_inputs(square.position, square.speed, square._ent.count, delta_time, up, down, left, right, fast);
+		if (up || down || left || right) {
+			update_spatial_hash(&square_hash, square.grid_link, square.position, square._ent.count);
+		}
 		move_by_velocity(particle.position, particle.velocity, particle._ent.count, delta_time);
 
-		/* Square rendering (non batched). */
-		render_sdl_rect(square.position, square.size, square.color, square._ent.count, renderer);
+		/* Square rendering. */
+		if (!batch) {
+			render_sdl_rect(square.position, square.size, square.color, square._ent.count, renderer);
+		} else {
+			generate_outline_rect_sdl_vertex(&vertex, square.position, square.size, square.color, square._ent.count);
+		}
 
 		/* Particle rendering. */
 		if (!batch) {
@@ -19,6 +19,7 @@ static inline f32   angle_between_points 	(f32v2 a, f32v2 b);
 static inline f32   rad_to_deg 			(f32 rad);
 static inline f32v2 tile_position_to_position 	(i32v2 tile_position, i32v2 tile_size);
 static inline f32v2 rotate_about 		(f32v2 point, f32v2 origin, f32 rad);
+static inline lwc32v2 position_to_lwc_position	(f32v2 position, f32 tile_size);
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -82,4 +83,14 @@ static inline f32v2 rotate_about(f32v2 point, f32v2 origin, f32 rad)
 	return rotated;
 }
 
+static inline lwc32v2 position_to_lwc_position(f32v2 position, f32 tile_size)
+{
+	const f32 tile_x = floorf(position.x / tile_size);
+	const f32 tile_y = floorf(position.y / tile_size);
+	return (lwc32v2){
+		.x = { (i32)tile_x, position.x - tile_x * tile_size },
+		.y = { (i32)tile_y, position.y - tile_y * tile_size },
+	};
+}
+
 #endif // MATH_HELPERS_H
@@ -0,0 +1,190 @@
+#pragma once
+
+/**
+ * @file
+ * @brief Batch Q16.16 fixed-point kernels over i32 columns.
+ *
+ * Everything here is integer arithmetic, so the results are bit-identical on
+ * every compiler and target, whatever the vectorization or the floating-point
+ * flags. The one double sqrt is only a guess that gets corrected exactly.
+ * sin/cos come from a quarter wave table with linear interpolation, angles are
+ * Q16.16 radians. Conversions from f32 round to nearest and clamp to the
+ * Q16.16 range of about +-32768.
+ *
+ * Right shifts of negative values are assumed to be arithmetic, which is what
+ * every supported compiler does.
+ */
+
+#ifndef SOA_FIXED_H
+#define SOA_FIXED_H
+
+#include <math.h>
+#include <types/primitive.h>
+
+typedef i32 q16; /*!< Q16.16 fixed-point */
+
+#define SOA_Q16_ONE 65536
+
+static inline void soa_q16_from_f32	(q16 *out, const f32 *a, usize count);
+static inline void soa_f32_from_q16	(f32 *out, const q16 *a, usize count);
+static inline void soa_q16_mul		(q16 *out, const q16 *a, const q16 *b, usize count);
+static inline void soa_q16_add_scaled	(q16 *out, const q16 *a, const q16 *b, q16 scale, usize count);
+static inline void soa_q16_scale	(q16 *out, const q16 *a, q16 scale, usize count);
+static inline void soa_q16_normalize2	(q16 *out_x, q16 *out_y, const q16 *x, const q16 *y, usize count);
+static inline void soa_q16_sincos	(q16 *out_sin, q16 *out_cos, const q16 *rad, usize count);
+static inline u64 soa_q16_hash		(u64 hash, const q16 *a, usize count);
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/* sin over a quarter turn in 256 steps, Q16.16. */
+static const q16 soa_q16_quarter_sin[257] = {
+	0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+	3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+	6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+	9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+	12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+	15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+	19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+	22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+	25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+	30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+	33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+	36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+	39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+	41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+	44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+	46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+	48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+	50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+	52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+	54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+	56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+	57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+	59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+	60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+	61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+	62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+	63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+	64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+	64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+	65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+	65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+	65536,
+};
+
+/* Rounds down, like the floor of the exact product. */
+static inline q16 soa_q16_mul1(q16 a, q16 b)
+{
+	return (q16)(((i64)a * b) >> 16);
+}
+
+static inline void soa_q16_from_f32(q16 *out, const f32 *a, usize count)
+{
+	const f32 limit = 32767.99f;
+	for (usize i = 0; i < count; i++) {
+		const f32 clamped = a[i] < -limit ? -limit : a[i] > limit ? limit : a[i];
+		const f32 scaled = clamped * (f32)SOA_Q16_ONE;
+		out[i] = (q16)(scaled + (scaled < 0.f ? -0.5f : 0.5f));
+	}
+}
+
+static inline void soa_f32_from_q16(f32 *out, const q16 *a, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		out[i] = (f32)a[i] * (1.f / (f32)SOA_Q16_ONE);
+	}
+}
+
+static inline void soa_q16_mul(q16 *out, const q16 *a, const q16 *b, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		out[i] = soa_q16_mul1(a[i], b[i]);
+	}
+}
+
+static inline void soa_q16_add_scaled(q16 *out, const q16 *a, const q16 *b, q16 scale, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		out[i] = a[i] + soa_q16_mul1(b[i], scale);
+	}
+}
+
+static inline void soa_q16_scale(q16 *out, const q16 *a, q16 scale, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		out[i] = soa_q16_mul1(a[i], scale);
+	}
+}
+
+/*
+ * Floor of the exact square root. The double root only gives a guess, the
+ * integer corrections make the result exact whatever the rounding was.
+ */
+static inline u32 soa_q16_isqrt(u64 a)
+{
+	u64 root = (u64)sqrt((f64)a);
+	root -= root * root > a;
+	root += (root + 1) * (root + 1) <= a;
+	return (u32)root;
+}
+
+/*
+ * One division per vector: the reciprocal carries 2^48 so that the product
+ * with a component, never larger than the length, still fits in 64 bits.
+ * Zero vectors stay zero.
+ */
+static inline void soa_q16_normalize2(q16 *out_x, q16 *out_y, const q16 *x, const q16 *y, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		const u64 length2 = (u64)((i64)x[i] * x[i]) + (u64)((i64)y[i] * y[i]);
+		const i64 length = soa_q16_isqrt(length2);
+		const i64 reciprocal = length != 0 ? ((i64)1 << 48) / length : 0;
+		out_x[i] = (q16)(((i64)x[i] * reciprocal) >> 32);
+		out_y[i] = (q16)(((i64)y[i] * reciprocal) >> 32);
+	}
+}
+
+/* sin of a position within the quarter turn, in units of 2^-30 turns. */
+static inline q16 soa_q16_quarter_lookup(u32 position)
+{
+	const u32 index = position >> 22;
+	const i32 fraction = (i32)((position >> 6) & 0xffffu);
+	const q16 a = soa_q16_quarter_sin[index];
+	const q16 b = soa_q16_quarter_sin[index + (index < 256)];
+	return a + (((b - a) * fraction) >> 16);
+}
+
+static inline void soa_q16_sincos(q16 *out_sin, q16 *out_cos, const q16 *rad, usize count)
+{
+	/* 2^32 / (2 pi), turns radians into a wrapping fraction of a turn. */
+	const i64 turn_scale = 683565276;
+	for (usize i = 0; i < count; i++) {
+		const u32 phase = (u32)(u64)(((i64)rad[i] * turn_scale) >> 16);
+		const u32 quadrant = phase >> 30;
+		const u32 position = phase & 0x3fffffffu;
+		const q16 rising = soa_q16_quarter_lookup(position);
+		const q16 falling = soa_q16_quarter_lookup((1u << 30) - position);
+		const q16 s = quadrant & 1u ? falling : rising;
+		const q16 c = quadrant & 1u ? rising : falling;
+		out_sin[i] = quadrant >= 2u ? -s : s;
+		out_cos[i] = quadrant == 1u || quadrant == 2u ? -c : c;
+	}
+}
+
+/* FNV-1a over the little endian bytes, so the hash is the same on any host. */
+static inline u64 soa_q16_hash(u64 hash, const q16 *a, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		const u32 bits = (u32)a[i];
+		for (u32 shift = 0; shift < 32; shift += 8) {
+			hash ^= (bits >> shift) & 0xffu;
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+#endif // SOA_FIXED_H
@@ -0,0 +1,717 @@
+#pragma once
+
+/**
+ * @file
+ * @brief Batch math kernels over f32 columns.
+ *
+ * Every kernel works on whole columns of count elements, the vector width is
+ * picked at build time from the SIMD flags that cglm detects: AVX (8 lanes),
+ * SSE2 or NEON on AArch64 (4 lanes), else plain scalar loops. Elements left
+ * over after the last full vector go through the scalar code, which is also
+ * the reference the tests compare against. Define SOA_MATH_NO_SIMD to force
+ * the scalar code everywhere.
+ *
+ * Outputs may alias inputs element for element (in place updates), but not
+ * with an offset. Masks are u32 columns of all ones or all zeros.
+ *
+ * Define SOA_MATH_FAST_NORMALIZE to have soa_f32_normalize2 use the
+ * approximate reciprocal square root instead of sqrt and two divisions.
+ *
+ * f16 columns are converted on load and on store, rounding to nearest even.
+ * F16C (8 lanes) and NEON on AArch64 (4 lanes) convert in hardware, other
+ * targets go through the scalar bit twiddling. With F16_IS_F32 the storage
+ * type is a float and the conversions are plain copies.
+ */
+
+#ifndef SOA_MATH_H
+#define SOA_MATH_H
+
+#include <types/primitive.h>
+
+static inline void soa_f32_add_scaled	(f32 *out, const f32 *a, const f32 *b, f32 scale, usize count);
+static inline void soa_f32_mul_add	(f32 *out, const f32 *a, const f32 *b, const f32 *c, usize count);
+static inline void soa_f32_lerp		(f32 *out, const f32 *a, const f32 *b, f32 t, usize count);
+static inline void soa_f32_clamp	(f32 *out, const f32 *a, f32 min, f32 max, usize count);
+static inline void soa_f32_length2	(f32 *out, const f32 *x, const f32 *y, usize count);
+static inline void soa_f32_normalize2	(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, usize count);
+static inline void soa_f32_normalize2_exact	(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, usize count);
+static inline void soa_f32_normalize2_fast	(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, usize count);
+static inline void soa_f32_rotate2	(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, const f32 *origin_x, const f32 *origin_y, const f32 *sin, const f32 *cos, usize count);
+static inline void soa_f32_sincos	(f32 *out_sin, f32 *out_cos, const f32 *rad, usize count);
+static inline void soa_f32_atan2	(f32 *out, const f32 *y, const f32 *x, usize count);
+static inline void soa_f32_less_mask	(u32 *out_mask, const f32 *a, const f32 *b, usize count);
+static inline void soa_f32_select	(f32 *out, const u32 *mask, const f32 *a, const f32 *b, usize count);
+static inline void soa_f32_interleave2	(f32 *out_xy, const f32 *x, const f32 *y, usize count);
+static inline void soa_f32_sort_key	(u32 *out, const f32 *a, usize count);
+static inline void soa_u32_radix_sort	(u32 *key, u32 *value, u32 *key_swap, u32 *value_swap, usize count);
+static inline f32 soa_f16_to_f32	(f16 a);
+static inline f16 soa_f32_to_f16	(f32 a);
+static inline void soa_f16_load		(f32 *out, const f16 *a, usize count);
+static inline void soa_f16_store	(f16 *out, const f32 *a, usize count);
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#include <float.h>
+#include <math.h>
+
+#ifndef SOA_MATH_NO_SIMD
+#include <cglm/common.h>
+#endif
+
+#if !defined(SOA_MATH_NO_SIMD) && defined(CGLM_AVX_FP)
+#define SOA_MATH_WIDTH 8
+typedef __m256 soa_f32xn;
+typedef __m256 soa_maskxn;
+#define soa_xn_load(p)			_mm256_loadu_ps(p)
+#define soa_xn_store(p, a)		_mm256_storeu_ps(p, a)
+#define soa_xn_set1(x)			_mm256_set1_ps(x)
+#define soa_xn_add(a, b)		_mm256_add_ps(a, b)
+#define soa_xn_sub(a, b)		_mm256_sub_ps(a, b)
+#define soa_xn_mul(a, b)		_mm256_mul_ps(a, b)
+#define soa_xn_div(a, b)		_mm256_div_ps(a, b)
+#define soa_xn_sqrt(a)			_mm256_sqrt_ps(a)
+#define soa_xn_rsqrt(a)			_mm256_rsqrt_ps(a)
+#define soa_xn_min(a, b)		_mm256_min_ps(a, b)
+#define soa_xn_max(a, b)		_mm256_max_ps(a, b)
+#define soa_xn_less(a, b)		_mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define soa_xn_select(m, a, b)		_mm256_blendv_ps(b, a, m)
+#define soa_xn_or_mask(m, n)		_mm256_or_ps(m, n)
+#define soa_xn_and_mask(m, n)		_mm256_and_ps(m, n)
+#define soa_xn_any_mask(m)		(_mm256_movemask_ps(m) != 0)
+#define soa_xn_load_mask(p)		_mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(p)))
+#define soa_xn_store_mask(p, m)		_mm256_storeu_si256((__m256i *)(p), _mm256_castps_si256(m))
+#define soa_xn_store_interleave2(p, a, b) do { \
+	const __m256 lo_ = _mm256_unpacklo_ps(a, b); \
+	const __m256 hi_ = _mm256_unpackhi_ps(a, b); \
+	_mm256_storeu_ps(p, _mm256_permute2f128_ps(lo_, hi_, 0x20)); \
+	_mm256_storeu_ps((p) + 8, _mm256_permute2f128_ps(lo_, hi_, 0x31)); \
+} while (0)
+#elif !defined(SOA_MATH_NO_SIMD) && defined(CGLM_SSE_FP)
+#define SOA_MATH_WIDTH 4
+typedef __m128 soa_f32xn;
+typedef __m128 soa_maskxn;
+#define soa_xn_load(p)			_mm_loadu_ps(p)
+#define soa_xn_store(p, a)		_mm_storeu_ps(p, a)
+#define soa_xn_set1(x)			_mm_set1_ps(x)
+#define soa_xn_add(a, b)		_mm_add_ps(a, b)
+#define soa_xn_sub(a, b)		_mm_sub_ps(a, b)
+#define soa_xn_mul(a, b)		_mm_mul_ps(a, b)
+#define soa_xn_div(a, b)		_mm_div_ps(a, b)
+#define soa_xn_sqrt(a)			_mm_sqrt_ps(a)
+#define soa_xn_rsqrt(a)			_mm_rsqrt_ps(a)
+#define soa_xn_min(a, b)		_mm_min_ps(a, b)
+#define soa_xn_max(a, b)		_mm_max_ps(a, b)
+#define soa_xn_less(a, b)		_mm_cmplt_ps(a, b)
+#define soa_xn_select(m, a, b)		_mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define soa_xn_or_mask(m, n)		_mm_or_ps(m, n)
+#define soa_xn_and_mask(m, n)		_mm_and_ps(m, n)
+#define soa_xn_any_mask(m)		(_mm_movemask_ps(m) != 0)
+#define soa_xn_load_mask(p)		_mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p)))
+#define soa_xn_store_mask(p, m)		_mm_storeu_si128((__m128i *)(p), _mm_castps_si128(m))
+#define soa_xn_store_interleave2(p, a, b) do { \
+	_mm_storeu_ps(p, _mm_unpacklo_ps(a, b)); \
+	_mm_storeu_ps((p) + 4, _mm_unpackhi_ps(a, b)); \
+} while (0)
+#elif !defined(SOA_MATH_NO_SIMD) && defined(CGLM_NEON_FP) && defined(__aarch64__)
+#define SOA_MATH_WIDTH 4
+typedef float32x4_t soa_f32xn;
+typedef uint32x4_t soa_maskxn;
+#define soa_xn_load(p)			vld1q_f32(p)
+#define soa_xn_store(p, a)		vst1q_f32(p, a)
+#define soa_xn_set1(x)			vdupq_n_f32(x)
+#define soa_xn_add(a, b)		vaddq_f32(a, b)
+#define soa_xn_sub(a, b)		vsubq_f32(a, b)
+#define soa_xn_mul(a, b)		vmulq_f32(a, b)
+#define soa_xn_div(a, b)		vdivq_f32(a, b)
+#define soa_xn_sqrt(a)			vsqrtq_f32(a)
+#define soa_xn_rsqrt(a)			vrsqrteq_f32(a)
+#define soa_xn_min(a, b)		vminq_f32(a, b)
+#define soa_xn_max(a, b)		vmaxq_f32(a, b)
+#define soa_xn_less(a, b)		vcltq_f32(a, b)
+#define soa_xn_select(m, a, b)		vbslq_f32(m, a, b)
+#define soa_xn_or_mask(m, n)		vorrq_u32(m, n)
+#define soa_xn_and_mask(m, n)		vandq_u32(m, n)
+#define soa_xn_any_mask(m)		(vmaxvq_u32(m) != 0)
+#define soa_xn_load_mask(p)		vld1q_u32(p)
+#define soa_xn_store_mask(p, m)		vst1q_u32(p, m)
+#define soa_xn_store_interleave2(p, a, b)	vst2q_f32(p, (float32x4x2_t){ { a, b } })
+#else
+#define SOA_MATH_WIDTH 1
+#endif
+
+/* Number of leading elements handled by full vectors. */
+static inline usize soa_math_vector_count(usize count)
+{
+	return count - count % SOA_MATH_WIDTH;
+}
+
+static inline void soa_f32_add_scaled(f32 *out, const f32 *a, const f32 *b, f32 scale, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn s = soa_xn_set1(scale);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		soa_xn_store(out + i, soa_xn_add(soa_xn_load(a + i), soa_xn_mul(soa_xn_load(b + i), s)));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = a[i] + b[i] * scale;
+	}
+}
+
+static inline void soa_f32_mul_add(f32 *out, const f32 *a, const f32 *b, const f32 *c, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		soa_xn_store(out + i, soa_xn_add(soa_xn_load(a + i), soa_xn_mul(soa_xn_load(b + i), soa_xn_load(c + i))));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = a[i] + b[i] * c[i];
+	}
+}
+
+static inline void soa_f32_lerp(f32 *out, const f32 *a, const f32 *b, f32 t, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn vt = soa_xn_set1(t);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn va = soa_xn_load(a + i);
+		soa_xn_store(out + i, soa_xn_add(va, soa_xn_mul(soa_xn_sub(soa_xn_load(b + i), va), vt)));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = a[i] + (b[i] - a[i]) * t;
+	}
+}
+
+static inline void soa_f32_clamp(f32 *out, const f32 *a, f32 min, f32 max, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn vmin = soa_xn_set1(min);
+	const soa_f32xn vmax = soa_xn_set1(max);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		soa_xn_store(out + i, soa_xn_min(soa_xn_max(soa_xn_load(a + i), vmin), vmax));
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 lower = a[i] > min ? a[i] : min;
+		out[i] = lower < max ? lower : max;
+	}
+}
+
+static inline void soa_f32_length2(f32 *out, const f32 *x, const f32 *y, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn vx = soa_xn_load(x + i);
+		const soa_f32xn vy = soa_xn_load(y + i);
+		soa_xn_store(out + i, soa_xn_sqrt(soa_xn_add(soa_xn_mul(vx, vx), soa_xn_mul(vy, vy))));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = sqrtf(x[i] * x[i] + y[i] * y[i]);
+	}
+}
+
+/* Zero length vectors normalize to zero. */
+static inline void soa_f32_normalize2(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, usize count)
+{
+#ifdef SOA_MATH_FAST_NORMALIZE
+	soa_f32_normalize2_fast(out_x, out_y, x, y, count);
+#else
+	soa_f32_normalize2_exact(out_x, out_y, x, y, count);
+#endif
+}
+
+/*
+ * Vectors whose squared length leaves the normal f32 range, below FLT_MIN or
+ * past FLT_MAX, are divided by their largest component first. The direction
+ * does not change and the squared length lands between 1 and 2.
+ */
+static inline void soa_math_normalize2_scaled(f32 *out_x, f32 *out_y, f32 x, f32 y)
+{
+	const f32 abs_x = fabsf(x);
+	const f32 abs_y = fabsf(y);
+	const f32 largest = abs_x > abs_y ? abs_x : abs_y;
+	const f32 scaled_x = x / largest;
+	const f32 scaled_y = y / largest;
+	const f32 length = sqrtf(scaled_x * scaled_x + scaled_y * scaled_y);
+	*out_x = scaled_x / length;
+	*out_y = scaled_y / length;
+}
+
+static inline bool soa_math_is_length2_scaled(f32 length2, f32 x, f32 y)
+{
+	return (length2 < FLT_MIN && (x != 0.f || y != 0.f)) || length2 > FLT_MAX;
+}
+
+#if SOA_MATH_WIDTH > 1
+static inline soa_maskxn soa_math_is_length2_scaled_xn(soa_f32xn length2, soa_f32xn vx, soa_f32xn vy)
+{
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	const soa_f32xn largest = soa_xn_max(soa_xn_max(vx, soa_xn_sub(zero, vx)), soa_xn_max(vy, soa_xn_sub(zero, vy)));
+	const soa_maskxn is_tiny = soa_xn_and_mask(soa_xn_less(zero, largest), soa_xn_less(length2, soa_xn_set1(FLT_MIN)));
+	return soa_xn_or_mask(is_tiny, soa_xn_less(soa_xn_set1(FLT_MAX), length2));
+}
+
+static inline void soa_math_normalize2_scaled_xn(soa_f32xn *out_x, soa_f32xn *out_y, soa_f32xn vx, soa_f32xn vy)
+{
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	const soa_f32xn abs_x = soa_xn_max(vx, soa_xn_sub(zero, vx));
+	const soa_f32xn abs_y = soa_xn_max(vy, soa_xn_sub(zero, vy));
+	const soa_f32xn largest = soa_xn_max(abs_x, abs_y);
+	const soa_f32xn scaled_x = soa_xn_div(vx, largest);
+	const soa_f32xn scaled_y = soa_xn_div(vy, largest);
+	const soa_f32xn length = soa_xn_sqrt(soa_xn_add(soa_xn_mul(scaled_x, scaled_x), soa_xn_mul(scaled_y, scaled_y)));
+	*out_x = soa_xn_div(scaled_x, length);
+	*out_y = soa_xn_div(scaled_y, length);
+}
+#endif
+
+static inline void soa_f32_normalize2_exact(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn vx = soa_xn_load(x + i);
+		const soa_f32xn vy = soa_xn_load(y + i);
+		const soa_f32xn length2 = soa_xn_add(soa_xn_mul(vx, vx), soa_xn_mul(vy, vy));
+		const soa_f32xn length = soa_xn_sqrt(length2);
+		const soa_maskxn is_nonzero = soa_xn_less(zero, length);
+		soa_f32xn dir_x = soa_xn_select(is_nonzero, soa_xn_div(vx, length), zero);
+		soa_f32xn dir_y = soa_xn_select(is_nonzero, soa_xn_div(vy, length), zero);
+		const soa_maskxn is_scaled = soa_math_is_length2_scaled_xn(length2, vx, vy);
+		if (soa_xn_any_mask(is_scaled)) {
+			soa_f32xn scaled_x, scaled_y;
+			soa_math_normalize2_scaled_xn(&scaled_x, &scaled_y, vx, vy);
+			dir_x = soa_xn_select(is_scaled, scaled_x, dir_x);
+			dir_y = soa_xn_select(is_scaled, scaled_y, dir_y);
+		}
+		soa_xn_store(out_x + i, dir_x);
+		soa_xn_store(out_y + i, dir_y);
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 length2 = x[i] * x[i] + y[i] * y[i];
+		if (soa_math_is_length2_scaled(length2, x[i], y[i])) {
+			soa_math_normalize2_scaled(out_x + i, out_y + i, x[i], y[i]);
+			continue;
+		}
+		const f32 length = sqrtf(length2);
+		const f32 dir_x = length != 0.f ? x[i] / length : 0.f;
+		const f32 dir_y = length != 0.f ? y[i] / length : 0.f;
+		out_x[i] = dir_x;
+		out_y[i] = dir_y;
+	}
+}
+
+/*
+ * Reciprocal square root estimate refined by one Newton-Raphson step, the
+ * length of the result is within 3e-7 of 1 on x86 (12 bit estimate) and
+ * within 5e-5 on NEON (8 bit estimate). The scalar tail is exact. The
+ * estimate only holds for a squared length in the normal f32 range, vectors
+ * outside of it take the exact path.
+ */
+static inline void soa_f32_normalize2_fast(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	const soa_f32xn half = soa_xn_set1(0.5f);
+	const soa_f32xn three_halves = soa_xn_set1(1.5f);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn vx = soa_xn_load(x + i);
+		const soa_f32xn vy = soa_xn_load(y + i);
+		const soa_f32xn length2 = soa_xn_add(soa_xn_mul(vx, vx), soa_xn_mul(vy, vy));
+		const soa_f32xn estimate = soa_xn_rsqrt(length2);
+		const soa_f32xn refine = soa_xn_sub(three_halves, soa_xn_mul(soa_xn_mul(half, length2), soa_xn_mul(estimate, estimate)));
+		const soa_f32xn inv_length = soa_xn_select(soa_xn_less(zero, length2), soa_xn_mul(estimate, refine), zero);
+		soa_f32xn dir_x = soa_xn_mul(vx, inv_length);
+		soa_f32xn dir_y = soa_xn_mul(vy, inv_length);
+		const soa_maskxn is_scaled = soa_math_is_length2_scaled_xn(length2, vx, vy);
+		if (soa_xn_any_mask(is_scaled)) {
+			soa_f32xn scaled_x, scaled_y;
+			soa_math_normalize2_scaled_xn(&scaled_x, &scaled_y, vx, vy);
+			dir_x = soa_xn_select(is_scaled, scaled_x, dir_x);
+			dir_y = soa_xn_select(is_scaled, scaled_y, dir_y);
+		}
+		soa_xn_store(out_x + i, dir_x);
+		soa_xn_store(out_y + i, dir_y);
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 length2 = x[i] * x[i] + y[i] * y[i];
+		if (soa_math_is_length2_scaled(length2, x[i], y[i])) {
+			soa_math_normalize2_scaled(out_x + i, out_y + i, x[i], y[i]);
+			continue;
+		}
+		const f32 inv_length = length2 > 0.f ? 1.f / sqrtf(length2) : 0.f;
+		out_x[i] = x[i] * inv_length;
+		out_y[i] = y[i] * inv_length;
+	}
+}
+
+/* Rotates points about their origin, sin and cos of the angle are columns. */
+static inline void soa_f32_rotate2(f32 *out_x, f32 *out_y, const f32 *x, const f32 *y, const f32 *origin_x, const f32 *origin_y, const f32 *sin, const f32 *cos, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn ox = soa_xn_load(origin_x + i);
+		const soa_f32xn oy = soa_xn_load(origin_y + i);
+		const soa_f32xn s = soa_xn_load(sin + i);
+		const soa_f32xn c = soa_xn_load(cos + i);
+		const soa_f32xn lx = soa_xn_sub(soa_xn_load(x + i), ox);
+		const soa_f32xn ly = soa_xn_sub(soa_xn_load(y + i), oy);
+		soa_xn_store(out_x + i, soa_xn_add(soa_xn_sub(soa_xn_mul(c, lx), soa_xn_mul(s, ly)), ox));
+		soa_xn_store(out_y + i, soa_xn_add(soa_xn_add(soa_xn_mul(s, lx), soa_xn_mul(c, ly)), oy));
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 lx = x[i] - origin_x[i];
+		const f32 ly = y[i] - origin_y[i];
+		const f32 rx = cos[i] * lx - sin[i] * ly;
+		const f32 ry = sin[i] * lx + cos[i] * ly;
+		out_x[i] = rx + origin_x[i];
+		out_y[i] = ry + origin_y[i];
+	}
+}
+
+/*
+ * Polynomial sincos, Cephes style: reduce to [-pi/4, pi/4] around the nearest
+ * multiple of pi/2, then pick and negate the sin and cos polynomials by the
+ * quadrant. Max absolute error is 8e-8 against sin/cos for |rad| <= 8192,
+ * the reduction loses precision beyond that.
+ */
+#define SOA_MATH_ROUND_MAGIC	12582912.f /* 1.5 * 2^23, adding it rounds to an integer. */
+#define SOA_MATH_TWO_OVER_PI	0.636619772367581343f
+#define SOA_MATH_PI_OVER_2_A	1.5703125f
+#define SOA_MATH_PI_OVER_2_B	4.837512969970703125e-4f
+#define SOA_MATH_PI_OVER_2_C	7.54978995489188216e-8f
+#define SOA_MATH_SIN_C0		-1.6666654611e-1f
+#define SOA_MATH_SIN_C1		8.3321608736e-3f
+#define SOA_MATH_SIN_C2		-1.9515295891e-4f
+#define SOA_MATH_COS_C0		4.166664568298827e-2f
+#define SOA_MATH_COS_C1		-1.388731625493765e-3f
+#define SOA_MATH_COS_C2		2.443315711809948e-5f
+
+static inline void soa_f32_sincos(f32 *out_sin, f32 *out_cos, const f32 *rad, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	const soa_f32xn one = soa_xn_set1(1.f);
+	const soa_f32xn half = soa_xn_set1(0.5f);
+	const soa_f32xn magic = soa_xn_set1(SOA_MATH_ROUND_MAGIC);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn x = soa_xn_load(rad + i);
+		const soa_f32xn j = soa_xn_sub(soa_xn_add(soa_xn_mul(x, soa_xn_set1(SOA_MATH_TWO_OVER_PI)), magic), magic);
+		soa_f32xn r = soa_xn_sub(x, soa_xn_mul(j, soa_xn_set1(SOA_MATH_PI_OVER_2_A)));
+		r = soa_xn_sub(r, soa_xn_mul(j, soa_xn_set1(SOA_MATH_PI_OVER_2_B)));
+		r = soa_xn_sub(r, soa_xn_mul(j, soa_xn_set1(SOA_MATH_PI_OVER_2_C)));
+		const soa_f32xn r2 = soa_xn_mul(r, r);
+
+		soa_f32xn s = soa_xn_add(soa_xn_mul(soa_xn_set1(SOA_MATH_SIN_C2), r2), soa_xn_set1(SOA_MATH_SIN_C1));
+		s = soa_xn_add(soa_xn_mul(s, r2), soa_xn_set1(SOA_MATH_SIN_C0));
+		s = soa_xn_add(soa_xn_mul(soa_xn_mul(s, r2), r), r);
+		soa_f32xn c = soa_xn_add(soa_xn_mul(soa_xn_set1(SOA_MATH_COS_C2), r2), soa_xn_set1(SOA_MATH_COS_C1));
+		c = soa_xn_add(soa_xn_mul(c, r2), soa_xn_set1(SOA_MATH_COS_C0));
+		c = soa_xn_add(soa_xn_sub(soa_xn_mul(soa_xn_mul(c, r2), r2), soa_xn_mul(half, r2)), one);
+
+		/* Quadrant m = j mod 4 in [-2, 2]. */
+		const soa_f32xn m = soa_xn_sub(j, soa_xn_mul(soa_xn_set1(4.f), soa_xn_sub(soa_xn_add(soa_xn_mul(j, soa_xn_set1(0.25f)), magic), magic)));
+		const soa_f32xn abs_m = soa_xn_max(m, soa_xn_sub(zero, m));
+		const soa_f32xn odd_distance = soa_xn_max(soa_xn_sub(abs_m, one), soa_xn_sub(one, abs_m));
+		const soa_maskxn is_odd = soa_xn_less(odd_distance, half);
+		const soa_maskxn is_sin_neg = soa_xn_or_mask(soa_xn_less(soa_xn_set1(1.5f), abs_m), soa_xn_less(m, soa_xn_set1(-0.5f)));
+		const soa_maskxn is_cos_neg = soa_xn_or_mask(soa_xn_less(half, m), soa_xn_less(m, soa_xn_set1(-1.5f)));
+		const soa_f32xn sin = soa_xn_select(is_odd, c, s);
+		const soa_f32xn cos = soa_xn_select(is_odd, s, c);
+		soa_xn_store(out_sin + i, soa_xn_select(is_sin_neg, soa_xn_sub(zero, sin), sin));
+		soa_xn_store(out_cos + i, soa_xn_select(is_cos_neg, soa_xn_sub(zero, cos), cos));
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 x = rad[i];
+		const f32 j = (x * SOA_MATH_TWO_OVER_PI + SOA_MATH_ROUND_MAGIC) - SOA_MATH_ROUND_MAGIC;
+		const f32 r = ((x - j * SOA_MATH_PI_OVER_2_A) - j * SOA_MATH_PI_OVER_2_B) - j * SOA_MATH_PI_OVER_2_C;
+		const f32 r2 = r * r;
+		const f32 s = ((SOA_MATH_SIN_C2 * r2 + SOA_MATH_SIN_C1) * r2 + SOA_MATH_SIN_C0) * r2 * r + r;
+		const f32 c = ((SOA_MATH_COS_C2 * r2 + SOA_MATH_COS_C1) * r2 + SOA_MATH_COS_C0) * r2 * r2 - 0.5f * r2 + 1.f;
+		const f32 m = j - 4.f * ((j * 0.25f + SOA_MATH_ROUND_MAGIC) - SOA_MATH_ROUND_MAGIC);
+		const f32 abs_m = m > -m ? m : -m;
+		const f32 odd_distance = abs_m - 1.f > 1.f - abs_m ? abs_m - 1.f : 1.f - abs_m;
+		const bool is_odd = odd_distance < 0.5f;
+		const bool is_sin_neg = abs_m > 1.5f || m < -0.5f;
+		const bool is_cos_neg = m > 0.5f || m < -1.5f;
+		const f32 sin = is_odd ? c : s;
+		const f32 cos = is_odd ? s : c;
+		out_sin[i] = is_sin_neg ? -sin : sin;
+		out_cos[i] = is_cos_neg ? -cos : cos;
+	}
+}
+
+/*
+ * Polynomial atan2: atan of min / max of |y| and |x| in [0, 1] with an odd
+ * minimax polynomial, then mirrored into the right octant. Max absolute error
+ * is 2e-6 rad against atan2, atan2(0, 0) is 0.
+ */
+#define SOA_MATH_PI		3.14159265358979323846f
+#define SOA_MATH_PI_OVER_2	1.57079632679489661923f
+#define SOA_MATH_ATAN_C0	0.99997726f
+#define SOA_MATH_ATAN_C1	-0.33262347f
+#define SOA_MATH_ATAN_C2	0.19354346f
+#define SOA_MATH_ATAN_C3	-0.11643287f
+#define SOA_MATH_ATAN_C4	0.05265332f
+#define SOA_MATH_ATAN_C5	-0.01172120f
+
+static inline void soa_f32_atan2(f32 *out, const f32 *y, const f32 *x, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn vy = soa_xn_load(y + i);
+		const soa_f32xn vx = soa_xn_load(x + i);
+		const soa_f32xn abs_y = soa_xn_max(vy, soa_xn_sub(zero, vy));
+		const soa_f32xn abs_x = soa_xn_max(vx, soa_xn_sub(zero, vx));
+		const soa_f32xn hi = soa_xn_max(abs_x, abs_y);
+		const soa_f32xn lo = soa_xn_min(abs_x, abs_y);
+		const soa_f32xn a = soa_xn_select(soa_xn_less(zero, hi), soa_xn_div(lo, hi), zero);
+		const soa_f32xn a2 = soa_xn_mul(a, a);
+
+		soa_f32xn p = soa_xn_add(soa_xn_mul(soa_xn_set1(SOA_MATH_ATAN_C5), a2), soa_xn_set1(SOA_MATH_ATAN_C4));
+		p = soa_xn_add(soa_xn_mul(p, a2), soa_xn_set1(SOA_MATH_ATAN_C3));
+		p = soa_xn_add(soa_xn_mul(p, a2), soa_xn_set1(SOA_MATH_ATAN_C2));
+		p = soa_xn_add(soa_xn_mul(p, a2), soa_xn_set1(SOA_MATH_ATAN_C1));
+		p = soa_xn_add(soa_xn_mul(p, a2), soa_xn_set1(SOA_MATH_ATAN_C0));
+		soa_f32xn r = soa_xn_mul(p, a);
+
+		r = soa_xn_select(soa_xn_less(abs_x, abs_y), soa_xn_sub(soa_xn_set1(SOA_MATH_PI_OVER_2), r), r);
+		r = soa_xn_select(soa_xn_less(vx, zero), soa_xn_sub(soa_xn_set1(SOA_MATH_PI), r), r);
+		soa_xn_store(out + i, soa_xn_select(soa_xn_less(vy, zero), soa_xn_sub(zero, r), r));
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 abs_y = y[i] > -y[i] ? y[i] : -y[i];
+		const f32 abs_x = x[i] > -x[i] ? x[i] : -x[i];
+		const f32 hi = abs_x > abs_y ? abs_x : abs_y;
+		const f32 lo = abs_x < abs_y ? abs_x : abs_y;
+		const f32 a = hi > 0.f ? lo / hi : 0.f;
+		const f32 a2 = a * a;
+		const f32 p = ((((SOA_MATH_ATAN_C5 * a2 + SOA_MATH_ATAN_C4) * a2 + SOA_MATH_ATAN_C3) * a2
+			+ SOA_MATH_ATAN_C2) * a2 + SOA_MATH_ATAN_C1) * a2 + SOA_MATH_ATAN_C0;
+		f32 r = p * a;
+		r = abs_x < abs_y ? SOA_MATH_PI_OVER_2 - r : r;
+		r = x[i] < 0.f ? SOA_MATH_PI - r : r;
+		out[i] = y[i] < 0.f ? -r : r;
+	}
+}
+
+static inline void soa_f32_less_mask(u32 *out_mask, const f32 *a, const f32 *b, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		soa_xn_store_mask(out_mask + i, soa_xn_less(soa_xn_load(a + i), soa_xn_load(b + i)));
+	}
+#endif
+	for (; i < count; i++) {
+		out_mask[i] = a[i] < b[i] ? 0xffffffffu : 0u;
+	}
+}
+
+static inline void soa_f32_select(f32 *out, const u32 *mask, const f32 *a, const f32 *b, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		soa_xn_store(out + i, soa_xn_select(soa_xn_load_mask(mask + i), soa_xn_load(a + i), soa_xn_load(b + i)));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = mask[i] ? a[i] : b[i];
+	}
+}
+
+/* Zips two columns into x0 y0 x1 y1..., the layout of interleaved vertex attributes. */
+static inline void soa_f32_interleave2(f32 *out_xy, const f32 *x, const f32 *y, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		soa_xn_store_interleave2(out_xy + 2 * i, soa_xn_load(x + i), soa_xn_load(y + i));
+	}
+#endif
+	for (; i < count; i++) {
+		out_xy[2 * i + 0] = x[i];
+		out_xy[2 * i + 1] = y[i];
+	}
+}
+
+/* Negative floats flip whole and positive ones on the sign bit, so that the
+ * keys compare as unsigned integers in the order of the floats. */
+static inline void soa_f32_sort_key(u32 *out, const f32 *a, usize count)
+{
+	for (usize i = 0; i < count; i++) {
+		const union { f32 f; u32 u; } bits = { a[i] };
+		const u32 mask = (u32)-(i32)(bits.u >> 31) | 0x80000000u;
+		out[i] = bits.u ^ mask;
+	}
+}
+
+/*
+ * Least significant byte first, so equal keys keep their order. The four
+ * histograms are built in one pass over the keys, and passes where every key
+ * has the same byte are skipped. The swap arrays hold count elements each,
+ * the result always ends up in key and value.
+ */
+static inline void soa_u32_radix_sort(u32 *key, u32 *value, u32 *key_swap, u32 *value_swap, usize count)
+{
+	if (count == 0) {
+		return;
+	}
+
+	u32 histogram[4][256] = { { 0 } };
+	for (usize i = 0; i < count; i++) {
+		const u32 k = key[i];
+		histogram[0][k & 0xffu] += 1;
+		histogram[1][(k >> 8) & 0xffu] += 1;
+		histogram[2][(k >> 16) & 0xffu] += 1;
+		histogram[3][k >> 24] += 1;
+	}
+
+	u32 *from_key = key, *from_value = value;
+	u32 *to_key = key_swap, *to_value = value_swap;
+	for (u32 pass = 0; pass < 4; pass++) {
+		u32 *offset = histogram[pass];
+		const u32 shift = pass * 8;
+		if (offset[(from_key[0] >> shift) & 0xffu] == count) continue;
+
+		u32 sum = 0;
+		for (usize b = 0; b < 256; b++) {
+			const u32 n = offset[b];
+			offset[b] = sum;
+			sum += n;
+		}
+		for (usize i = 0; i < count; i++) {
+			const u32 o = offset[(from_key[i] >> shift) & 0xffu]++;
+			to_key[o] = from_key[i];
+			to_value[o] = from_value[i];
+		}
+
+		u32 *k = from_key, *v = from_value;
+		from_key = to_key, from_value = to_value;
+		to_key = k, to_value = v;
+	}
+
+	if (from_key != key) {
+		for (usize i = 0; i < count; i++) {
+			key[i] = from_key[i];
+			value[i] = from_value[i];
+		}
+	}
+}
+
+#if !defined(F16_IS_F32) && !defined(SOA_MATH_NO_SIMD) && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define SOA_MATH_F16_WIDTH 8
+#elif !defined(F16_IS_F32) && !defined(SOA_MATH_NO_SIMD) && defined(CGLM_NEON_FP) && defined(__aarch64__)
+#define SOA_MATH_F16_WIDTH 4
+#else
+#define SOA_MATH_F16_WIDTH 1
+#endif
+
+static inline f32 soa_f16_to_f32(f16 a)
+{
+#ifdef F16_IS_F32
+	return a._;
+#else
+	const u32 sign = (u32)(a._ & 0x8000u) << 16;
+	const u32 exponent = (a._ >> 10) & 0x1fu;
+	const u32 mantissa = a._ & 0x3ffu;
+	union { u32 u; f32 f; } bits;
+	if (exponent == 0x1fu) {
+		bits.u = sign | 0x7f800000u | (mantissa << 13);
+	} else if (exponent != 0) {
+		bits.u = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+	} else {
+		/* Zero or subnormal, the mantissa counts units of 2^-24. */
+		bits.f = (f32)mantissa * (1.f / 16777216.f);
+		bits.u |= sign;
+	}
+	return bits.f;
+#endif
+}
+
+static inline f16 soa_f32_to_f16(f32 a)
+{
+#ifdef F16_IS_F32
+	return (f16){ a };
+#else
+	union { f32 f; u32 u; } bits = { a };
+	const u32 sign = (bits.u >> 16) & 0x8000u;
+	const u32 abs = bits.u & 0x7fffffffu;
+	u32 half;
+	if (abs >= 0x7f800000u) {
+		/* Infinity stays infinity, NaN stays quiet NaN. */
+		half = 0x7c00u | (abs > 0x7f800000u ? 0x200u : 0u);
+	} else if (abs >= 0x477ff000u) {
+		/* 65520 and above round to infinity. */
+		half = 0x7c00u;
+	} else if (abs < 0x38800000u) {
+		/* Below 2^-14 the result is subnormal. Adding 0.5 lines the mantissa
+		 * up with units of 2^-24 and lets the FPU round to nearest even. */
+		union { f32 f; u32 u; } denormal = { .u = abs };
+		denormal.f += 0.5f;
+		half = denormal.u - 0x3f000000u;
+	} else {
+		const u32 is_odd = (abs >> 13) & 1u;
+		half = (abs - (112u << 23) + 0xfffu + is_odd) >> 13;
+	}
+	return (f16){ (u16)(sign | half) };
+#endif
+}
+
+static inline void soa_f16_load(f32 *out, const f16 *a, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_F16_WIDTH == 8
+	for (; i < count - count % 8; i += 8) {
+		_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(a + i))));
+	}
+#elif SOA_MATH_F16_WIDTH == 4
+	for (; i < count - count % 4; i += 4) {
+		vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16((const u16 *)(a + i)))));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = soa_f16_to_f32(a[i]);
+	}
+}
+
+static inline void soa_f16_store(f16 *out, const f32 *a, usize count)
+{
+	usize i = 0;
+#if SOA_MATH_F16_WIDTH == 8
+	for (; i < count - count % 8; i += 8) {
+		_mm_storeu_si128((__m128i *)(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(a + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+#elif SOA_MATH_F16_WIDTH == 4
+	for (; i < count - count % 4; i += 4) {
+		vst1_u16((u16 *)(out + i), vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(a + i))));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = soa_f32_to_f16(a[i]);
+	}
+}
+
+#endif // SOA_MATH_H
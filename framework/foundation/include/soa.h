@@ -19,6 +19,12 @@ typedef struct soa_slot_t {
 	u32 idx;
 } soa_slot_t;
 
+/** Consecutive slots idx up to idx + count. */
+typedef struct soa_slot_range_t {
+	u32 idx;
+	u32 count;
+} soa_slot_range_t;
+
 typedef struct soa_entity_t {
 	usize count;
 	usize clear_count;
@@ -27,9 +33,16 @@ typedef struct soa_entity_t {
 	u8bool is_occupied[SOA_LIMIT];
 } soa_entity_t;
 
+/**
+ * Fixed step accumulator. When max_steps is not zero, a frame runs at most
+ * that many steps and the whole steps left over are dropped, so that a hitch
+ * does not snowball into ever longer catch-up frames.
+ */
 typedef struct soa_timer_t {
 	f64seconds counter;
 	f64seconds dt;
+	u32 max_steps;
+	u32 step_count;
 } soa_timer_t;
 
 #define SOA_ENTITY_ZERO \
@@ -48,14 +61,22 @@ usize soa_round_up(usize number, usize multiple);
 usize soa_simd_count(usize vector_size, usize scalar_size, usize count);
 
 soa_slot_t soa_new_slot1(soa_entity_t *entity);
+/**
+ * Allocates up to count consecutive slots after the last used one. Free
+ * slots are left to soa_new_slot1, they do not form a range. The range is
+ * shorter than count when the entity runs into SOA_LIMIT.
+ */
+soa_slot_range_t soa_new_slots(soa_entity_t *entity, usize count);
 void soa_free_slot(soa_entity_t *entity, const soa_slot_t *slots, usize slot_count);
 void soa_clear(soa_entity_t *entity);
 
 soa_timer_t soa_timer_init(void);
 void soa_timer_fini(soa_timer_t *timer);
 void soa_timer_tick(soa_timer_t *timer, f64seconds dt);
+void soa_timer_set_max_steps(soa_timer_t *timer, u32 max_steps);
 bool soa_timer_do_frame(soa_timer_t *timer, f64 interval);
 f64 soa_timer_delta_seconds(const soa_timer_t *timer);
+f64 soa_timer_alpha(const soa_timer_t *timer);
 
 #ifdef __cplusplus
 }
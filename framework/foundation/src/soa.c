@@ -1,5 +1,6 @@
 #include "soa.h"
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 
 usize soa_round_up(
@@ -37,6 +38,22 @@ soa_slot_t soa_new_slot1(
 	return slot;
 }
 
+soa_slot_range_t soa_new_slots(
+	soa_entity_t *entity,
+	usize count)
+{
+	const usize space = entity->count < SOA_LIMIT ? SOA_LIMIT - entity->count : 0;
+	const soa_slot_range_t range = {
+		.idx = (u32)entity->count,
+		.count = (u32)(count < space ? count : space),
+	};
+	for (usize i = range.idx; i < (usize)range.idx + range.count; i++) {
+		entity->is_occupied[i] = true;
+	}
+	entity->count += range.count;
+	return range;
+}
+
 void soa_free_slot(
 	soa_entity_t *entity,
 	const soa_slot_t *slots,
@@ -82,15 +99,29 @@ void soa_timer_tick(
 	soa_timer_t *timer, f64seconds dt)
 {
 	timer->counter.seconds += dt.seconds;
+	timer->step_count = 0;
+}
+
+void soa_timer_set_max_steps(
+	soa_timer_t *timer,
+	u32 max_steps)
+{
+	timer->max_steps = max_steps;
 }
 
 bool soa_timer_do_frame(
 	soa_timer_t *timer,
 	f64 interval)
 {
+	if (timer->max_steps != 0 && timer->step_count >= timer->max_steps) {
+		/* keep the remainder so that the alpha stays below one */
+		timer->counter.seconds = fmod(timer->counter.seconds, interval);
+		return false;
+	}
 	if (timer->counter.seconds >= interval) {
 		timer->counter.seconds -= interval;
 		timer->dt.seconds = interval;
+		timer->step_count += 1;
 		return true;
 	}
 	return false;
@@ -101,3 +132,12 @@ f64 soa_timer_delta_seconds(
 {
 	return timer->dt.seconds;
 }
+
+f64 soa_timer_alpha(
+	const soa_timer_t *timer)
+{
+	if (timer->dt.seconds <= 0.0) {
+		return 0.0;
+	}
+	return timer->counter.seconds / timer->dt.seconds;
+}
@@ -12,12 +12,27 @@
 extern "C" {
 #endif
 
+/**
+ * Frame clock shared by a whole entity set, since every entity of a set plays
+ * the same animation. frame counts from begin_frame and stays below
+ * frame_count.
+ */
+typedef struct soa_animation_clock {
+	u8 begin_frame;
+	u8 frame_count;
+	u8 frame;
+	f32seconds elapsed;
+	f32seconds frame_time;
+} soa_animation_clock;
+
+/**
+ * Entities only keep their offset from the clock frame, below frame_count.
+ * The offset goes back by one clock frame for every frame an entity spends
+ * standing still, which holds its frame.
+ */
 typedef struct soa_animation {
-	u8 begin_frame[SOA_LIMIT];
-	u8 end_frame[SOA_LIMIT];
-	u8 current_frame[SOA_LIMIT];
-	f32seconds frame_elapsed[SOA_LIMIT];
-	f32seconds frame_time[SOA_LIMIT];
+	soa_animation_clock clock;
+	u8 phase[SOA_LIMIT];
 } soa_animation;
 
 #ifdef __cplusplus
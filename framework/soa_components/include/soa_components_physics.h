@@ -21,6 +21,27 @@ typedef struct soa_weight {
 	f32 kg[SOA_LIMIT];
 } soa_weight;
 
+enum {
+	SOA_CONTACT_LIMIT = 4 * SOA_LIMIT,
+};
+
+/**
+ * Circle contacts between the slots of two entity sets, which can be the same
+ * set. Normals point from a to b, depth is the overlap of the two circles and
+ * the inverse masses are gathered once so the solver iterations stay on linear
+ * memory. A weight of zero is an immovable body.
+ */
+typedef struct soa_contact {
+	usize count;
+	soa_slot_t a[SOA_CONTACT_LIMIT];
+	soa_slot_t b[SOA_CONTACT_LIMIT];
+	f32 normal_x[SOA_CONTACT_LIMIT];
+	f32 normal_y[SOA_CONTACT_LIMIT];
+	f32 depth[SOA_CONTACT_LIMIT];
+	f32 inv_mass_a[SOA_CONTACT_LIMIT];
+	f32 inv_mass_b[SOA_CONTACT_LIMIT];
+} soa_contact2;
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,8 @@
  */
 
 #include <soa.h>
+#include <soa_components_vertex.h>
+#include <types/bundle.h>
 #include <types/primitive.h>
 #include <SDL.h>
 
@@ -17,6 +19,83 @@ typedef struct soa_sdl2_vertex {
 	SDL_Vertex val[SOA_LIMIT];
 } soa_sdl2_vertex;
 
+enum {
+	SOA_RENDER_QUEUE_LIMIT = SOA_LIMIT,
+	SOA_RENDER_QUEUE_QUAD_LIMIT = SOA_QUAD_LIMIT,
+	SOA_RENDER_STATE_LIMIT = 64,
+};
+
+/**
+ * Renderer state a command is drawn with. Colors are not part of it, they go
+ * with the vertices.
+ */
+typedef struct soa_render_state {
+	SDL_Texture *texture;
+	SDL_BlendMode blend_mode;
+} soa_render_state;
+
+/**
+ * What the submissions of a frame cost: how many commands, how many geometry
+ * calls, and how often the texture and the blend mode changed between them.
+ */
+typedef struct soa_render_stats {
+	u32 command_count;
+	u32 draw_count;
+	u32 texture_changes;
+	u32 blend_mode_changes;
+} soa_render_stats;
+
+/**
+ * Sorted quads from first_quad on that share one state, drawn with one call.
+ */
+typedef struct soa_render_batch {
+	u32 state;
+	u32 first_quad;
+	u32 quad_count;
+} soa_render_batch;
+
+/**
+ * Quads recorded during the frame and drawn at submission. A command is a
+ * run of quads, one for a sprite, four for an outline, and a key, its layer
+ * above the index of its state in the state table. Commands are sorted by
+ * key, so layers keep their order while the commands of a layer are grouped
+ * by state, and consecutive commands with the same state go out in one
+ * SDL_RenderGeometry call.
+ */
+typedef struct soa_render_queue {
+	SDL_Renderer *renderer;
+	usize count;
+	usize quad_count;
+	usize state_count;
+	soa_render_state state[SOA_RENDER_STATE_LIMIT];
+	u32 key[SOA_RENDER_QUEUE_LIMIT];
+	u32 first_quad[SOA_RENDER_QUEUE_LIMIT];
+	u32 command_quads[SOA_RENDER_QUEUE_LIMIT];
+	SDL_Vertex vertex[4 * SOA_RENDER_QUEUE_QUAD_LIMIT];
+	SDL_Vertex sorted_vertex[4 * SOA_RENDER_QUEUE_QUAD_LIMIT];
+	usize batch_count;
+	soa_render_batch batch[SOA_RENDER_QUEUE_LIMIT];
+	soa_render_stats stats;
+} soa_render_queue;
+
+enum {
+	SOA_TILEMAP_CHUNK_LIMIT = 256,
+};
+
+/**
+ * Tilemap layers baked into render target textures of chunk_tiles x
+ * chunk_tiles tiles. A chunk is baked again only when it is marked dirty,
+ * otherwise drawing the map is one copy per chunk on screen.
+ */
+typedef struct soa_tilemap_chunks {
+	u32 chunk_tiles;
+	u32 width;
+	u32 height;
+	i32v2 tile_size;
+	SDL_Texture *texture[SOA_TILEMAP_CHUNK_LIMIT];
+	u8bool is_dirty[SOA_TILEMAP_CHUNK_LIMIT];
+} soa_tilemap_chunks;
+
 #ifdef __cplusplus
 }
 #endif
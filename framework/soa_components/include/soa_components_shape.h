@@ -12,9 +12,10 @@
 extern "C" {
 #endif
 
+/* Half floats, sizes are small whole numbers of pixels. */
 typedef struct soa_size {
-	f32 w[SOA_LIMIT];
-	f32 h[SOA_LIMIT];
+	f16 w[SOA_LIMIT];
+	f16 h[SOA_LIMIT];
 } soa_size2;
 
 #ifdef __cplusplus
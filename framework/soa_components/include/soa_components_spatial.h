@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file
+ * @brief Spatial components.
+ */
+
+#include <soa.h>
+#include <types/bundle.h>
+#include <types/primitive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	SOA_SPATIAL_GRID_CELL_LIMIT = 4096,
+};
+
+/**
+ * Uniform grid over the bounds of an entity set, rebuilt from scratch with a
+ * counting sort. Entities of a cell are stored contiguously, positions are
+ * copied alongside the slots so that neighbour loops stay on linear memory.
+ */
+typedef struct soa_spatial_grid {
+	f32v2 origin;
+	f32 cell_size;
+	u32 width;
+	u32 height;
+	u32 count;
+	u32 cell_start[SOA_SPATIAL_GRID_CELL_LIMIT + 1];
+	soa_slot_t slot[SOA_LIMIT];
+	f32 x[SOA_LIMIT];
+	f32 y[SOA_LIMIT];
+} soa_spatial_grid;
+
+#ifdef __cplusplus
+}
+#endif
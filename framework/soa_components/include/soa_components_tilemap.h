@@ -17,6 +17,13 @@ typedef struct soa_tile_position2 {
 	i32 y[SOA_LIMIT];
 } soa_tile_position2;
 
+typedef struct soa_raycast_hit {
+	f32 distance[SOA_LIMIT];
+	i32 tile_x[SOA_LIMIT];
+	i32 tile_y[SOA_LIMIT];
+	u8bool is_hit[SOA_LIMIT];
+} soa_raycast_hit;
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,8 +23,21 @@ typedef struct soa_position {
 	f32 z[SOA_LIMIT];
 } soa_position3;
 
-typedef struct soa_rotation {
+/**
+ * Large world position, split like lwc32 into whole tiles and an offset inside
+ * the tile. The offsets stay small so that f32 keeps sub-pixel precision
+ * anywhere on the map. The tile size is given to the systems using it.
+ */
+typedef struct soa_lwc_position {
+	i32 tile_x[SOA_LIMIT];
+	i32 tile_y[SOA_LIMIT];
 	f32 x[SOA_LIMIT];
+	f32 y[SOA_LIMIT];
+} soa_lwc_position2;
+
+/* Half floats, radians within one turn keep about 0.1 degree of precision. */
+typedef struct soa_rotation {
+	f16 x[SOA_LIMIT];
 } soa_rotation1;
 
 #ifdef __cplusplus
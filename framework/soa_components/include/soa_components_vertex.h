@@ -23,6 +23,21 @@ typedef struct soa_xy_st_rgba8 {
 	soa_xy_st_rgba8_t val[SOA_LIMIT];
 } soa_xy_st_rgba8;
 
+/* Enough quads for a render queue full of outlines, four quads each. */
+enum {
+	SOA_QUAD_LIMIT = 4 * SOA_LIMIT,
+	SOA_TRIANGLE_INDEX_LIMIT = 3 * SOA_LIMIT,
+};
+
+/**
+ * Triangle indices written per frame. Clipping can split every triangle of the
+ * quads in two, so the limit is twice their indices.
+ */
+typedef struct soa_triangle_index {
+	usize count;
+	int val[SOA_TRIANGLE_INDEX_LIMIT];
+} soa_triangle_index;
+
 #ifdef __cplusplus
 }
 #endif
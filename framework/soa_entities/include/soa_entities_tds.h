@@ -14,6 +14,7 @@
 #include <soa_components_movement.h>
 #include <soa_components_physics.h>
 #include <soa_components_shape.h>
+#include <soa_components_tilemap.h>
 #include <soa_components_transform.h>
 #include <types/bundle.h>
 #include <types/primitive.h>
@@ -25,9 +26,12 @@ extern "C" {
 typedef struct soa_character {
 	soa_entity_t _ent;
 	soa_position2 position;
+	soa_position2 old_position;
 	soa_rotation1 rotation;
 	soa_size2 size;
 	soa_velocity2 velocity;
+	soa_velocity2 knockback;
+	soa_weight weight;
 	soa_speed speed;
 	soa_movement2 movement;
 	soa_animation animation;
@@ -40,27 +44,46 @@ typedef struct soa_character {
 typedef struct soa_bullet {
 	soa_entity_t _ent;
 	soa_position2 position;
+	soa_position2 old_position;
 	soa_rotation1 rotation;
 	soa_size2 size;
 	soa_velocity2 velocity;
+	soa_weight weight;
 	soa_destination2 destination;
 	soa_speed speed;
 	soa_movement2 movement;
 	soa_animation animation;
 	soa_clip clip;
 	soa_damage damage;
+	soa_raycast_hit wall_hit;
 } soa_bullet;
 
+/*
+ * Props are moved only by knockback and keep large world positions. The f32
+ * map_position, relative to the map origin, is what the spatial queries shared
+ * with the characters read, refreshed whenever the props moved.
+ */
+typedef struct soa_prop {
+	soa_entity_t _ent;
+	soa_lwc_position2 position;
+	soa_lwc_position2 old_position;
+	soa_position2 map_position;
+	soa_size2 size;
+	soa_velocity2 knockback;
+	soa_weight weight;
+	soa_animation animation;
+	soa_clip clip;
+	soa_health health;
+	soa_damage damage;
+} soa_prop;
+
 typedef struct soa_character_desc_t {
 	f32v2 position;
 	f32v2 size;
 	f32 speed;
+	f32 weight;
 	f32 health;
-	struct {
-		u8 begin_frame;
-		u8 end_frame;
-		f32seconds frame_time;
-	} animation;
+	f32 damage;
 } soa_character_desc_t;
 
 typedef struct soa_bullet_desc_t {
@@ -68,14 +91,18 @@ typedef struct soa_bullet_desc_t {
 	f32v2 destination;
 	f32v2 size;
 	f32 speed;
+	f32 weight;
 	f32 damage;
-	struct {
-		u8 begin_frame;
-		u8 end_frame;
-		f32seconds frame_time;
-	} animation;
 } soa_bullet_desc_t;
 
+typedef struct soa_prop_desc_t {
+	lwc32v2 position;
+	f32v2 size;
+	f32 weight;
+	f32 health;
+	f32 damage;
+} soa_prop_desc_t;
+
 soa_slot_t soa_character_new1(
 	soa_character *character,
 	const soa_character_desc_t *desc);
@@ -84,6 +111,10 @@ soa_slot_t soa_bullet_new1(
 	soa_bullet *bullet,
 	const soa_bullet_desc_t *desc);
 
+soa_slot_t soa_prop_new1(
+	soa_prop *prop,
+	const soa_prop_desc_t *desc);
+
 void soa_character_free(
 	soa_character *character,
 	const soa_slot_t *slot,
@@ -94,6 +125,11 @@ void soa_bullet_free(
 	const soa_slot_t *slots,
 	const usize slot_count);
 
+void soa_prop_free(
+	soa_prop *prop,
+	const soa_slot_t *slots,
+	const usize slot_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,4 @@
-#include <math/math_helpers.h>
+#include <math/soa_math.h>
 #include <soa_entities_tds.h>
 
 soa_slot_t soa_character_new1(
@@ -9,14 +9,17 @@ soa_slot_t soa_character_new1(
 	const usize c = slot.idx;
 	character->position.x[c] = desc->position.x;
 	character->position.y[c] = desc->position.y;
-	character->size.w[c] = desc->size.width;
-	character->size.h[c] = desc->size.height;
+	character->old_position.x[c] = desc->position.x;
+	character->old_position.y[c] = desc->position.y;
+	character->size.w[c] = soa_f32_to_f16(desc->size.width);
+	character->size.h[c] = soa_f32_to_f16(desc->size.height);
 	character->speed.val[c] = desc->speed;
+	character->weight.kg[c] = desc->weight;
+	character->knockback.x[c] = 0.f;
+	character->knockback.y[c] = 0.f;
 	character->health.val[c] = desc->health;
-	character->animation.begin_frame[c] = desc->animation.begin_frame;
-	character->animation.end_frame[c] = desc->animation.end_frame;
-	character->animation.current_frame[c] = desc->animation.begin_frame;
-	character->animation.frame_time[c].seconds = desc->animation.frame_time.seconds;
+	character->damage.val[c] = desc->damage;
+	character->animation.phase[c] = 0;
 	character->color.r[c] = 255;
 	character->color.g[c] = 255;
 	character->color.b[c] = 255;
@@ -32,17 +35,46 @@ soa_slot_t soa_bullet_new1(
 	const usize b = slot.idx;
 	bullet->position.x[b] = desc->position.x;
 	bullet->position.y[b] = desc->position.y;
+	bullet->old_position.x[b] = desc->position.x;
+	bullet->old_position.y[b] = desc->position.y;
 	bullet->destination.x[b] = desc->destination.x;
 	bullet->destination.y[b] = desc->destination.y;
-	bullet->rotation.x[b] = angle_between_points(desc->position, desc->destination);
-	bullet->size.w[b] = desc->size.width;
-	bullet->size.h[b] = desc->size.height;
+	const f32 dy = desc->position.y - desc->destination.y;
+	const f32 dx = desc->position.x - desc->destination.x;
+	f32 rotation;
+	soa_f32_atan2(&rotation, &dy, &dx, 1);
+	bullet->rotation.x[b] = soa_f32_to_f16(rotation);
+	bullet->size.w[b] = soa_f32_to_f16(desc->size.width);
+	bullet->size.h[b] = soa_f32_to_f16(desc->size.height);
 	bullet->speed.val[b] = desc->speed;
+	bullet->weight.kg[b] = desc->weight;
 	bullet->damage.val[b] = desc->damage;
-	bullet->animation.begin_frame[b] = desc->animation.begin_frame;
-	bullet->animation.end_frame[b] = desc->animation.end_frame;
-	bullet->animation.current_frame[b] = desc->animation.begin_frame;
-	bullet->animation.frame_time[b].seconds = desc->animation.frame_time.seconds;
+	bullet->animation.phase[b] = 0;
+	return slot;
+}
+
+soa_slot_t soa_prop_new1(
+	soa_prop *prop,
+	const soa_prop_desc_t *desc)
+{
+	const soa_slot_t slot = soa_new_slot1(&prop->_ent);
+	const usize p = slot.idx;
+	prop->position.tile_x[p] = desc->position.x.tile;
+	prop->position.tile_y[p] = desc->position.y.tile;
+	prop->position.x[p] = desc->position.x.local;
+	prop->position.y[p] = desc->position.y.local;
+	prop->old_position.tile_x[p] = desc->position.x.tile;
+	prop->old_position.tile_y[p] = desc->position.y.tile;
+	prop->old_position.x[p] = desc->position.x.local;
+	prop->old_position.y[p] = desc->position.y.local;
+	prop->size.w[p] = soa_f32_to_f16(desc->size.width);
+	prop->size.h[p] = soa_f32_to_f16(desc->size.height);
+	prop->weight.kg[p] = desc->weight;
+	prop->knockback.x[p] = 0.f;
+	prop->knockback.y[p] = 0.f;
+	prop->health.val[p] = desc->health;
+	prop->damage.val[p] = desc->damage;
+	prop->animation.phase[p] = 0;
 	return slot;
 }
 
@@ -54,8 +86,8 @@ void soa_character_free(
 	for (usize i = 0; i < slot_count; i++) {
 		const usize c = slots[i].idx;
 		character->damage.val[c] = 0.f;
-		character->size.w[c] = 0.f;
-		character->size.h[c] = 0.f;
+		character->size.w[c] = (f16){ 0 };
+		character->size.h[c] = (f16){ 0 };
 	}
 	soa_free_slot(&character->_ent, slots, slot_count);
 }
@@ -68,8 +100,22 @@ void soa_bullet_free(
 	for (usize i = 0; i < slot_count; i++) {
 		const usize b = slots[i].idx;
 		bullet->damage.val[b] = 0.f;
-		bullet->size.w[b] = 0.f;
-		bullet->size.h[b] = 0.f;
+		bullet->size.w[b] = (f16){ 0 };
+		bullet->size.h[b] = (f16){ 0 };
 	}
 	soa_free_slot(&bullet->_ent, slots, slot_count);
 }
+
+void soa_prop_free(
+	soa_prop *prop,
+	const soa_slot_t *slots,
+	const usize slot_count)
+{
+	for (usize i = 0; i < slot_count; i++) {
+		const usize p = slots[i].idx;
+		prop->damage.val[p] = 0.f;
+		prop->size.w[p] = (f16){ 0 };
+		prop->size.h[p] = (f16){ 0 };
+	}
+	soa_free_slot(&prop->_ent, slots, slot_count);
+}
@@ -15,6 +15,11 @@ typedef struct soa_animation soa_animation;
 typedef struct soa_clip soa_clip;
 typedef struct soa_velocity soa_velocity2;
 typedef struct tileset_t tileset_t;
+typedef struct tile_animation_t tile_animation_t;
+
+void soa_init_animation_clock(
+	soa_animation *e_animation,
+	const tile_animation_t *animation);
 
 void soa_progress_animation_if_moving(
 	soa_animation *e_animation,
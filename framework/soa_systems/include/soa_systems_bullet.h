@@ -17,6 +17,8 @@ typedef struct soa_size soa_size2;
 typedef struct soa_health soa_health;
 typedef struct soa_damage soa_damage;
 typedef struct soa_destination soa_destination2;
+typedef struct soa_velocity soa_velocity2;
+typedef struct soa_weight soa_weight;
 
 void soa_detect_bullet_collisions_with_something(
 	const soa_position2 *s_position,
@@ -35,6 +37,15 @@ void soa_bullet_damages_something(
 	const soa_slot_t *bullet_slots,
 	const usize slots_count);
 
+void soa_bullet_knocks_back_something(
+	soa_velocity2 *s_knockback,
+	const soa_weight *s_weight,
+	const soa_velocity2 *b_velocity,
+	const soa_weight *b_weight,
+	const soa_slot_t *something_slots,
+	const soa_slot_t *bullet_slots,
+	const usize slots_count);
+
 #ifdef __cplusplus
 }
 #endif
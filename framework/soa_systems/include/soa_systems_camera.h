@@ -13,18 +13,58 @@ extern "C" {
 
 typedef struct soa_position soa_position2;
 typedef struct soa_position soa_position3;
+typedef struct soa_lwc_position soa_lwc_position2;
+typedef struct soa_size soa_size2;
+typedef struct soa_slot_t soa_slot_t;
+typedef struct soa_entity_t soa_entity_t;
+typedef struct soa_color1 soa_color1;
+typedef struct soa_texcoord soa_texcoord;
+typedef struct soa_triangle_index soa_triangle_index;
 
 void soa_apply_camera_2d(
 	soa_position2 *e_position,
 	const usize entity_count,
 	f32v2 camera);
 
+void soa_apply_camera_2d_lwc(
+	const soa_lwc_position2 *e_position,
+	const usize entity_count,
+	lwc32v2 camera,
+	const f32 tile_size,
+	soa_position2 *out_position);
+
 void soa_apply_camera_3d(
 	soa_position3 *e_position,
 	const usize entity_count,
 	f32v3 camera,
 	f32v2 viewport);
 
+void soa_clip_triangles_3d(
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	soa_entity_t *vertex_entity,
+	soa_triangle_index *out_index);
+
+void soa_get_visible_mask(
+	const f32 *x,
+	const f32 *y,
+	const f32 *width,
+	const f32 *height,
+	const usize count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	u32 *out_mask);
+
+void soa_get_visible_slots(
+	const soa_position2 *e_position,
+	const soa_size2 *e_size,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	soa_slot_t *out_slots,
+	usize *out_count);
+
 #ifdef __cplusplus
 }
 #endif
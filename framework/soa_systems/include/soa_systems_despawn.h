@@ -15,6 +15,8 @@ typedef struct soa_slot_t soa_slot_t;
 typedef struct soa_position soa_position2;
 typedef struct soa_destination soa_destination2;
 typedef struct soa_health soa_health;
+typedef struct soa_speed soa_speed;
+typedef struct soa_raycast_hit soa_raycast_hit;
 
 void soa_get_destination_reached_despawn_slots(
 	const soa_position2 *e_position,
@@ -30,6 +32,14 @@ void soa_get_dead_despawn_slots(
 	soa_slot_t *output,
 	usize *output_count);
 
+void soa_get_raycast_blocked_despawn_slots(
+	const soa_raycast_hit *e_hit,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const f32seconds dt,
+	soa_slot_t *output,
+	usize *output_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,36 @@
+#pragma once
+
+/**
+ * @file
+ * @brief Explosion systems.
+ */
+
+#include <types/primitive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct soa_slot_t soa_slot_t;
+typedef struct soa_entity_t soa_entity_t;
+typedef struct soa_health soa_health;
+typedef struct soa_damage soa_damage;
+
+void soa_get_exploding_slots(
+	const soa_health *e_health,
+	const soa_entity_t *entity,
+	soa_slot_t *output,
+	usize *output_count);
+
+void soa_explosion_damages_something(
+	soa_health *s_health,
+	const soa_damage *x_damage,
+	const f32 radius,
+	const soa_slot_t *something_slots,
+	const soa_slot_t *explosion_slots,
+	const f32 *distances,
+	const usize slots_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,6 +17,8 @@ typedef struct soa_rotation soa_rotation1;
 typedef struct soa_movement soa_movement2;
 typedef struct soa_speed soa_speed;
 typedef struct soa_velocity soa_velocity2;
+typedef struct soa_animation soa_animation;
+typedef struct soa_spatial_grid soa_spatial_grid;
 
 void soa_movement_to_velocity(
 	const soa_movement2 *e_movement,
@@ -24,6 +26,23 @@ void soa_movement_to_velocity(
 	soa_velocity2 *e_velocity,
 	const usize entity_count);
 
+void soa_move(
+	soa_position2 *e_position,
+	soa_velocity2 *e_velocity,
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const f32seconds dt);
+
+void soa_move_and_animate(
+	soa_position2 *e_position,
+	soa_velocity2 *e_velocity,
+	soa_animation *e_animation,
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const f32seconds dt);
+
 void soa_follow_one_target(
 	soa_movement2 *f_movement,
 	const soa_position2 *f_position,
@@ -32,6 +51,22 @@ void soa_follow_one_target(
 	const soa_position2 *t_position,
 	const soa_slot_t target_slot);
 
+void soa_follow_nearest_target(
+	soa_movement2 *f_movement,
+	const soa_position2 *f_position,
+	const soa_speed *f_speed,
+	const usize follower_count,
+	const soa_position2 *t_position,
+	const soa_spatial_grid *t_grid);
+
+void soa_separate_from_neighbours(
+	soa_movement2 *e_movement,
+	const soa_position2 *e_position,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const soa_spatial_grid *e_grid,
+	const f32 radius);
+
 void soa_forward_movement_from_rotation(
 	soa_movement2 *e_movement,
 	const soa_rotation1 *e_rotation,
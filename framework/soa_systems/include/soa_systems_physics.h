@@ -12,7 +12,12 @@ extern "C" {
 #endif
 
 typedef struct soa_position soa_position2;
+typedef struct soa_lwc_position soa_lwc_position2;
 typedef struct soa_velocity soa_velocity2;
+typedef struct soa_weight soa_weight;
+typedef struct soa_contact soa_contact2;
+typedef struct soa_slot_t soa_slot_t;
+typedef struct soa_spatial_grid soa_spatial_grid;
 
 void soa_reset_velocity(
 	soa_velocity2 *e_velocity,
@@ -24,6 +29,60 @@ void soa_apply_forwards_velocity(
 	const usize entity_count,
 	const f32seconds dt);
 
+void soa_apply_forwards_velocity_lwc(
+	soa_lwc_position2 *e_position,
+	const soa_velocity2 *e_velocity,
+	const usize entity_count,
+	const f32seconds dt);
+
+void soa_add_contacts(
+	soa_contact2 *contacts,
+	const soa_position2 *a_position,
+	const soa_weight *a_weight,
+	const soa_position2 *b_position,
+	const soa_weight *b_weight,
+	const soa_slot_t *a_slots,
+	const soa_slot_t *b_slots,
+	const f32 *distances,
+	const usize pair_count,
+	const f32 radius,
+	const bool is_same_set);
+
+void soa_solve_contacts(
+	const soa_contact2 *contacts,
+	soa_velocity2 *a_velocity,
+	soa_velocity2 *b_velocity,
+	const usize iterations,
+	const f32seconds dt);
+
+void soa_push_apart(
+	soa_contact2 *contacts,
+	const soa_position2 *a_position,
+	const soa_weight *a_weight,
+	soa_velocity2 *a_knockback,
+	const soa_spatial_grid *a_grid,
+	const soa_position2 *b_position,
+	const soa_weight *b_weight,
+	soa_velocity2 *b_knockback,
+	const soa_spatial_grid *b_grid,
+	const f32 radius,
+	const usize iterations,
+	const f32seconds dt);
+
+void soa_apply_knockback(
+	soa_position2 *e_position,
+	soa_velocity2 *e_knockback,
+	const usize entity_count,
+	const f32 damping,
+	const f32seconds dt);
+
+void soa_apply_knockback_lwc(
+	soa_lwc_position2 *e_position,
+	soa_velocity2 *e_knockback,
+	const usize entity_count,
+	const f32 damping,
+	const f32seconds dt);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
  * @brief SDL2 systems.
  */
 
+#include <SDL2/SDL_render.h>
 #include <types/primitive.h>
 #include <types/bundle.h>
 
@@ -13,6 +14,7 @@ extern "C" {
 #endif
 
 typedef struct soa_position soa_position2;
+typedef struct soa_position soa_position3;
 typedef struct soa_rotation soa_rotation1;
 typedef struct soa_color soa_color;
 typedef struct soa_color1 soa_color1;
@@ -20,14 +22,15 @@ typedef struct soa_texcoord soa_texcoord;
 typedef struct soa_size soa_size2;
 typedef struct soa_clip soa_clip;
 typedef struct soa_sdl2_vertex soa_sdl2_vertex;
+typedef struct soa_render_queue soa_render_queue;
+typedef struct soa_triangle_index soa_triangle_index;
+typedef struct soa_tilemap_chunks soa_tilemap_chunks;
 typedef struct soa_entity_t soa_entity_t;
 typedef struct tilemap_t tilemap_t;
 typedef struct tileset_t tileset_t;
 typedef struct tilemap_encoding_t tilemap_encoding_t;
-typedef struct SDL_Renderer SDL_Renderer;
-typedef struct SDL_Texture SDL_Texture;
 
-void soa_make_sdl2_vertex(
+usize soa_make_sdl2_vertex(
 	const soa_position2 *e_position,
 	const soa_color1 *e_color,
 	const soa_texcoord *e_texcoord,
@@ -41,6 +44,23 @@ void soa_draw_geometry(
 	SDL_Renderer *renderer,
 	SDL_Texture *texture);
 
+void soa_draw_quads_raw(
+	const soa_position3 *v_position,
+	const soa_color1 *v_color,
+	const soa_texcoord *v_texcoord,
+	const usize vertex_count,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture);
+
+void soa_draw_triangles_raw(
+	const soa_position3 *v_position,
+	const soa_color1 *v_color,
+	const soa_texcoord *v_texcoord,
+	const usize vertex_count,
+	const soa_triangle_index *triangle_index,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture);
+
 void soa_draw_sprite(
 	const soa_position2 *e_position,
 	const soa_size2 *e_size,
@@ -48,14 +68,16 @@ void soa_draw_sprite(
 	const usize entity_count,
 	SDL_Renderer *renderer,
 	SDL_Texture *texture,
-	const f32v2 camera);
+	const f32v2 camera,
+	const f32v2 viewport);
 
 void soa_draw_rect(
 	const soa_position2 *e_position,
 	const soa_size2 *e_size,
 	const usize entity_count,
 	SDL_Renderer *renderer,
-	const f32v2 camera);
+	const f32v2 camera,
+	const f32v2 viewport);
 
 void soa_draw_sprite_rotated(
 	const soa_position2 *e_position,
@@ -65,7 +87,72 @@ void soa_draw_sprite_rotated(
 	const usize entity_count,
 	SDL_Renderer *renderer,
 	SDL_Texture *texture,
-	const f32v2 camera);
+	const f32v2 camera,
+	const f32v2 viewport);
+
+void soa_draw_sprite_batch(
+	const SDL_Vertex *vertex,
+	const usize quad_count,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture);
+
+void soa_init_render_queue(
+	soa_render_queue *queue);
+
+void soa_begin_render_queue(
+	soa_render_queue *queue,
+	SDL_Renderer *renderer);
+
+void soa_sort_render_queue(
+	soa_render_queue *queue);
+
+void soa_submit_render_queue(
+	soa_render_queue *queue);
+
+void soa_queue_sprite(
+	const soa_position2 *e_position,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	SDL_Texture *texture,
+	const SDL_BlendMode blend_mode,
+	const f32v2 texture_size,
+	soa_render_queue *queue);
+
+void soa_queue_sprite_rotated(
+	const soa_position2 *e_position,
+	const soa_rotation1 *e_rotation,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	SDL_Texture *texture,
+	const SDL_BlendMode blend_mode,
+	const f32v2 texture_size,
+	soa_render_queue *queue);
+
+void soa_queue_fill_rect(
+	const f32rect rect,
+	const u8v4 color,
+	const u8 layer,
+	const SDL_BlendMode blend_mode,
+	soa_render_queue *queue);
+
+void soa_queue_rect(
+	const soa_position2 *e_position,
+	const soa_size2 *e_size,
+	const soa_color *e_color,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	const SDL_BlendMode blend_mode,
+	soa_render_queue *queue);
 
 void soa_draw_tilemap(
 	const tilemap_t *tilemap,
@@ -74,13 +161,50 @@ void soa_draw_tilemap(
 	const i32v2 tile_size,
 	SDL_Renderer *renderer,
 	SDL_Texture *tilesheet_texture,
-	const f32v2 camera);
+	const f32v2 camera,
+	const f32v2 viewport);
 
-void soa_draw_tilemap_collision_buffer(
+void soa_init_tilemap_chunks(
+	soa_tilemap_chunks *chunks,
 	const tilemap_t *tilemap,
 	const i32v2 tile_size,
+	SDL_Renderer *renderer);
+
+void soa_fini_tilemap_chunks(
+	soa_tilemap_chunks *chunks);
+
+void soa_invalidate_tilemap_chunk(
+	soa_tilemap_chunks *chunks,
+	const i32v2 tile_position);
+
+void soa_invalidate_tilemap_chunks(
+	soa_tilemap_chunks *chunks);
+
+void soa_bake_tilemap_chunks(
+	soa_tilemap_chunks *chunks,
+	const tilemap_t *tilemap,
+	const tilemap_encoding_t *tilemap_encoding,
+	const tileset_t *tileset,
 	SDL_Renderer *renderer,
-	const f32v2 camera);
+	SDL_Texture *tilesheet_texture);
+
+void soa_draw_tilemap_chunks(
+	const soa_tilemap_chunks *chunks,
+	const tilemap_t *tilemap,
+	const tilemap_encoding_t *tilemap_encoding,
+	const tileset_t *tileset,
+	SDL_Renderer *renderer,
+	SDL_Texture *tilesheet_texture,
+	const f32v2 camera,
+	const f32v2 viewport);
+
+void soa_queue_tilemap_collision_buffer(
+	const tilemap_t *tilemap,
+	const i32v2 tile_size,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	soa_render_queue *queue);
 
 #ifdef __cplusplus
 }
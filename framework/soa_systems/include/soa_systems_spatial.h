@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * @file
+ * @brief Spatial systems.
+ */
+
+#include <types/primitive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct soa_slot_t soa_slot_t;
+typedef struct soa_entity_t soa_entity_t;
+typedef struct soa_position soa_position2;
+typedef struct soa_spatial_grid soa_spatial_grid;
+
+void soa_build_spatial_grid(
+	const soa_position2 *e_position,
+	const soa_entity_t *entity,
+	const f32 cell_size,
+	soa_spatial_grid *out_grid);
+
+void soa_find_nearest_in_spatial_grid(
+	const soa_position2 *q_position,
+	const usize query_count,
+	const soa_spatial_grid *grid,
+	soa_slot_t *out_nearest,
+	u8bool *out_found);
+
+void soa_find_in_radius_in_spatial_grid(
+	const soa_position2 *q_position,
+	const soa_slot_t *q_slots,
+	const usize query_count,
+	const f32 radius,
+	const soa_spatial_grid *grid,
+	const usize out_capacity,
+	soa_slot_t *out_query_slots,
+	soa_slot_t *out_found_slots,
+	f32 *out_distance,
+	usize *out_count,
+	usize *out_query_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -15,6 +15,8 @@ extern "C" {
 typedef struct soa_slot_t soa_slot_t;
 typedef struct soa_position soa_position2;
 typedef struct soa_velocity soa_velocity2;
+typedef struct soa_movement soa_movement2;
+typedef struct soa_raycast_hit soa_raycast_hit;
 typedef struct tilemap_t tilemap_t;
 typedef struct tilemap_encoding_t tilemap_encoding_t;
 typedef struct tile_properties_t tile_properties_t;
@@ -32,6 +34,15 @@ void soa_multiply_velocity_by_future_tile_speed(
 	const i32v2 tile_size,
 	const f32seconds dt);
 
+void soa_raycast_tilemap(
+	const soa_position2 *r_origin,
+	const soa_movement2 *r_direction,
+	const usize ray_count,
+	const f32 max_distance,
+	const tilemap_t *tilemap,
+	const i32v2 tile_size,
+	soa_raycast_hit *out_hit);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,7 @@ extern "C" {
 
 typedef struct soa_slot_t soa_slot_t;
 typedef struct soa_position soa_position2;
+typedef struct soa_lwc_position soa_lwc_position2;
 
 f32v2 soa_get_one_position2(
 	const soa_position2 *e_position,
@@ -29,6 +30,32 @@ void soa_backup_position2(
 	soa_position2 *e_old_position,
 	const usize entity_count);
 
+void soa_interpolate_position2(
+	const soa_position2 *e_old_position,
+	const soa_position2 *e_position,
+	const usize entity_count,
+	const f32 alpha,
+	soa_position2 *out_position);
+
+lwc32v2 soa_get_one_lwc_position2(
+	const soa_lwc_position2 *e_position,
+	const soa_slot_t entity_slot);
+
+void soa_change_one_lwc_position2(
+	soa_lwc_position2 *e_position,
+	const soa_slot_t entity_slot,
+	const lwc32v2 new_position);
+
+void soa_backup_lwc_position2(
+	const soa_lwc_position2 *e_position,
+	soa_lwc_position2 *e_old_position,
+	const usize entity_count);
+
+void soa_renormalize_lwc_position2(
+	soa_lwc_position2 *e_position,
+	const usize entity_count,
+	const f32 tile_size);
+
 #ifdef __cplusplus
 }
 #endif
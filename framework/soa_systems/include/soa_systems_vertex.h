@@ -20,6 +20,7 @@ typedef struct soa_clip soa_clip;
 typedef struct soa_color soa_color;
 typedef struct soa_color1 soa_color1;
 typedef struct soa_texcoord soa_texcoord;
+typedef struct soa_triangle_index soa_triangle_index;
 typedef struct soa_entity_t soa_entity_t;
 
 void soa_make_cube(
@@ -30,7 +31,10 @@ void soa_make_cube(
 	f32v3 position,
 	f32 size);
 
-void soa_make_sprite_vertices(
+const int *soa_get_quad_index(
+	void);
+
+usize soa_make_sprite_vertices(
 	const soa_position2 *e_position,
 	const soa_rotation1 *e_rotation,
 	const soa_size2 *e_size,
@@ -43,7 +47,7 @@ void soa_make_sprite_vertices(
 	soa_entity_t *vertex_entity,
 	f32v2 texture_size);
 
-void soa_make_sprite_vertices_3d(
+usize soa_make_sprite_vertices_3d(
 	const soa_position2 *e_position,
 	const soa_rotation1 *e_rotation,
 	const soa_size2 *e_size,
@@ -56,6 +60,16 @@ void soa_make_sprite_vertices_3d(
 	soa_entity_t *vertex_entity,
 	f32v2 texture_size);
 
+void soa_sort_quads_by_y(
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	const usize vertex_count);
+
+void soa_sort_triangles_by_depth(
+	const soa_position3 *v_position,
+	soa_triangle_index *index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,35 +5,59 @@
 #include <soa_systems_animation.h>
 #include <tilemap.h>
 
+void soa_init_animation_clock(
+	soa_animation *e_animation,
+	const tile_animation_t *animation)
+{
+	e_animation->clock = (soa_animation_clock) {
+		.begin_frame = (u8)animation->begin_tile_frame,
+		.frame_count = (u8)(animation->end_tile_frame - animation->begin_tile_frame + 1),
+		.frame_time = animation->frame_time,
+	};
+}
+
 void soa_progress_animation_if_moving(
 	soa_animation *e_animation,
 	const soa_velocity2 *e_velocity,
 	const usize entity_count,
 	const f32seconds dt)
 {
+	soa_animation_clock *clock = &e_animation->clock;
+	clock->elapsed.seconds += dt.seconds;
+	const bool is_advancing = clock->elapsed.seconds > clock->frame_time.seconds;
+	if (!is_advancing) {
+		return;
+	}
+	clock->elapsed.seconds = 0.f;
+	clock->frame = clock->frame + 1 < clock->frame_count ? clock->frame + 1 : 0;
+
+	/* Entities standing still step back by one frame to hold theirs. */
+	const u8 frame_count = clock->frame_count;
+	const u8 hold = frame_count - 1;
 	for (usize e = 0; e < entity_count; e++) {
-		if (e_velocity->x[e] != 0.f || e_velocity->y[e] != 0.f) {
-			e_animation->frame_elapsed[e].seconds += dt.seconds;
-		}
-		if (e_animation->frame_elapsed[e].seconds > e_animation->frame_time[e].seconds) {
-			e_animation->frame_elapsed[e].seconds = 0.f;
-			e_animation->current_frame[e] += 1;
-			if (e_animation->current_frame[e] > e_animation->end_frame[e]) {
-				e_animation->current_frame[e] = e_animation->begin_frame[e];
-			}
-		}
+		const bool is_moving = (e_velocity->x[e] != 0.f) | (e_velocity->y[e] != 0.f);
+		const u8 phase = e_animation->phase[e] + (is_moving ? 0 : hold);
+		e_animation->phase[e] = phase >= frame_count ? phase - frame_count : phase;
 	}
 }
 
+/* Frames only differ by their offset, so the tiles are looked up once per offset. */
 void soa_fetch_tileset_animation(
 	const soa_animation *e_animation,
 	soa_clip *e_clip,
 	const usize entity_count,
 	const tileset_t *tileset)
 {
+	const soa_animation_clock *clock = &e_animation->clock;
+	const u8 frame_count = clock->frame_count;
+	tile_t tiles[256];
+	for (u32 f = 0; f < frame_count; f++) {
+		tiles[f] = tileset->enum_to_tile[clock->begin_frame + f];
+	}
+
 	for (usize e = 0; e < entity_count; e++) {
-		const tile_enum_t tile_enum = e_animation->current_frame[e];
-		const tile_t tile = tileset->enum_to_tile[tile_enum];
+		const u32 offset = (u32)clock->frame + e_animation->phase[e];
+		const tile_t tile = tiles[offset >= frame_count ? offset - frame_count : offset];
 		e_clip->x[e] = tile.x;
 		e_clip->y[e] = tile.y;
 		e_clip->w[e] = tile.w;
@@ -1,7 +1,9 @@
+#include <math/soa_math.h>
 #include <soa.h>
 #include <soa_components_damage.h>
 #include <soa_components_health.h>
 #include <soa_components_movement.h>
+#include <soa_components_physics.h>
 #include <soa_components_shape.h>
 #include <soa_components_transform.h>
 #include <soa_systems_despawn.h>
@@ -20,6 +22,11 @@ void soa_detect_bullet_collisions_with_something(
 {
 	usize total_collided_count = 0;
 
+	f32 something_w[something_count];
+	f32 something_h[something_count];
+	soa_f16_load(something_w, s_size->w, something_count);
+	soa_f16_load(something_h, s_size->h, something_count);
+
 #pragma omp parallel if (bullet_count > 256)
 {
 	soa_slot_t worker_collided_somethings[something_count];
@@ -29,7 +36,7 @@ void soa_detect_bullet_collisions_with_something(
 	for (usize b = 0; b < bullet_count; b++) {
 		for (usize s = 0; s < something_count; s++) {
 			const f32v2 pos = { b_position->x[b], b_position->y[b] };
-			const f32rect rect = { s_position->x[s], s_position->y[s], s_size->w[s], s_size->h[s] };
+			const f32rect rect = { s_position->x[s], s_position->y[s], something_w[s], something_h[s] };
 			const bool overlaps = (pos.x > rect.x) && (pos.x < rect.x + rect.w) &&
 						(pos.y > rect.y) && (pos.y < rect.y + rect.h);
 			if (overlaps) {
@@ -65,3 +72,23 @@ void soa_bullet_damages_something(
 		s_health->val[s] -= b_damage->val[b];
 	}
 }
+
+/* The bullet momentum goes into the knockback, immovable somethings ignore it. */
+void soa_bullet_knocks_back_something(
+	soa_velocity2 *s_knockback,
+	const soa_weight *s_weight,
+	const soa_velocity2 *b_velocity,
+	const soa_weight *b_weight,
+	const soa_slot_t *something_slots,
+	const soa_slot_t *bullet_slots,
+	const usize slots_count)
+{
+	for (usize i = 0; i < slots_count; i++) {
+		const usize s = something_slots[i].idx;
+		const usize b = bullet_slots[i].idx;
+		const f32 ms = s_weight->kg[s];
+		const f32 ratio = ms > 0.f ? b_weight->kg[b] / ms : 0.f;
+		s_knockback->x[s] += b_velocity->x[b] * ratio;
+		s_knockback->y[s] += b_velocity->y[b] * ratio;
+	}
+}
@@ -1,7 +1,17 @@
 #include <cglm/cglm.h>
 #include <math/math_helpers.h>
+#include <math/soa_math.h>
+#include <soa.h>
+#include <soa_components_color.h>
+#include <soa_components_graphics.h>
+#include <soa_components_shape.h>
 #include <soa_components_transform.h>
+#include <soa_components_vertex.h>
 #include <soa_systems_camera.h>
+#include <soa_systems_vertex.h>
+
+/* Near plane of the 3D projection, also the plane triangles are clipped to. */
+static const f32 camera_3d_near = 1.f;
 
 void soa_apply_camera_2d(
 	soa_position2 *e_position,
@@ -14,6 +24,34 @@ void soa_apply_camera_2d(
 	}
 }
 
+/*
+ * Tiles are subtracted as integers before going to f32, so the result keeps
+ * the precision of the offsets however far the camera is from the origin.
+ */
+void soa_apply_camera_2d_lwc(
+	const soa_lwc_position2 *e_position,
+	const usize entity_count,
+	lwc32v2 camera,
+	const f32 tile_size,
+	soa_position2 *out_position)
+{
+	for (usize e = 0; e < entity_count; e++) {
+		const i32 tiles_x = e_position->tile_x[e] - camera.x.tile;
+		const i32 tiles_y = e_position->tile_y[e] - camera.y.tile;
+		out_position->x[e] = (f32)tiles_x * tile_size + (e_position->x[e] - camera.x.local);
+		out_position->y[e] = (f32)tiles_y * tile_size + (e_position->y[e] - camera.y.local);
+	}
+}
+
+/*
+ * The camera is the eye, looking along z with y going down the screen like in
+ * the 2D world, so the z = 0 plane reads the same as with the 2D camera.
+ * Vertices go to homogeneous screen space: the viewport mapping is folded
+ * into the projection, so x and y only wait for the divide by w, and z keeps
+ * w, the view depth. Clipping stays linear in that space, soa_clip_triangles_3d
+ * clips against the near plane and divides. Each row of the matrix is
+ * broadcast once and the loop transforms a vector of vertices per iteration.
+ */
 void soa_apply_camera_3d(
 	soa_position3 *e_position,
 	const usize entity_count,
@@ -22,27 +60,277 @@ void soa_apply_camera_3d(
 {
 	f32v3 target = camera;
 	target.z += 1.f;
-	mat4 model, view, proj, vp, mvp;
-	glm_mat4_identity(model);
-	glm_lookat(camera.raw, target.raw, (vec3){ 0, 1, 0 }, view);
-	glm_perspective(10.f, viewport.width / viewport.height, 0.001f, 100.f, proj);
-	glm_mat4_mul(proj, view, vp);
-	glm_mat4_mul(vp, model, mvp);
+	mat4 view, proj, mvp;
+	glm_lookat(camera.raw, target.raw, (vec3){ 0, -1, 0 }, view);
+	glm_perspective(glm_rad(60.f), viewport.width / viewport.height, camera_3d_near, 10000.f, proj);
+	glm_mat4_mul(proj, view, mvp);
+
+	/* cglm matrices are column major, row r of column c is mvp[c][r]. */
+	const f32 half_w = viewport.width * 0.5f;
+	const f32 half_h = viewport.height * 0.5f;
+	f32 row_x[4], row_y[4], row_w[4];
+	for (usize c = 0; c < 4; c++) {
+		row_x[c] = half_w * (mvp[c][0] + mvp[c][3]);
+		row_y[c] = half_h * (mvp[c][3] - mvp[c][1]);
+		row_w[c] = mvp[c][3];
+	}
+
+	f32 *x = e_position->x;
+	f32 *y = e_position->y;
+	f32 *z = e_position->z;
+	usize e = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn x0 = soa_xn_set1(row_x[0]), x1 = soa_xn_set1(row_x[1]);
+	const soa_f32xn x2 = soa_xn_set1(row_x[2]), x3 = soa_xn_set1(row_x[3]);
+	const soa_f32xn y0 = soa_xn_set1(row_y[0]), y1 = soa_xn_set1(row_y[1]);
+	const soa_f32xn y2 = soa_xn_set1(row_y[2]), y3 = soa_xn_set1(row_y[3]);
+	const soa_f32xn w0 = soa_xn_set1(row_w[0]), w1 = soa_xn_set1(row_w[1]);
+	const soa_f32xn w2 = soa_xn_set1(row_w[2]), w3 = soa_xn_set1(row_w[3]);
+	for (; e < soa_math_vector_count(entity_count); e += SOA_MATH_WIDTH) {
+		const soa_f32xn px = soa_xn_load(x + e);
+		const soa_f32xn py = soa_xn_load(y + e);
+		const soa_f32xn pz = soa_xn_load(z + e);
+		soa_xn_store(x + e, soa_xn_add(soa_xn_add(soa_xn_mul(px, x0), soa_xn_mul(py, x1)),
+			soa_xn_add(soa_xn_mul(pz, x2), x3)));
+		soa_xn_store(y + e, soa_xn_add(soa_xn_add(soa_xn_mul(px, y0), soa_xn_mul(py, y1)),
+			soa_xn_add(soa_xn_mul(pz, y2), y3)));
+		soa_xn_store(z + e, soa_xn_add(soa_xn_add(soa_xn_mul(px, w0), soa_xn_mul(py, w1)),
+			soa_xn_add(soa_xn_mul(pz, w2), w3)));
+	}
+#endif
+	for (; e < entity_count; e++) {
+		const f32 px = x[e];
+		const f32 py = y[e];
+		const f32 pz = z[e];
+		x[e] = px * row_x[0] + py * row_x[1] + pz * row_x[2] + row_x[3];
+		y[e] = px * row_y[0] + py * row_y[1] + pz * row_y[2] + row_y[3];
+		z[e] = px * row_w[0] + py * row_w[1] + pz * row_w[2] + row_w[3];
+	}
+}
+
+/* Appends the point where the edge from a to b crosses the near plane. */
+static int clip_edge(
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	soa_entity_t *vertex_entity,
+	const int a,
+	const int b)
+{
+	const f32 t = (v_position->z[a] - camera_3d_near) / (v_position->z[a] - v_position->z[b]);
+	const usize v = soa_new_slot1(vertex_entity).idx;
+	v_position->x[v] = v_position->x[a] + (v_position->x[b] - v_position->x[a]) * t;
+	v_position->y[v] = v_position->y[a] + (v_position->y[b] - v_position->y[a]) * t;
+	v_position->z[v] = camera_3d_near;
+	v_texcoord->s[v] = v_texcoord->s[a] + (v_texcoord->s[b] - v_texcoord->s[a]) * t;
+	v_texcoord->t[v] = v_texcoord->t[a] + (v_texcoord->t[b] - v_texcoord->t[a]) * t;
+	for (usize c = 0; c < 4; c++) {
+		const f32 ca = v_color->val[a].raw[c];
+		const f32 cb = v_color->val[b].raw[c];
+		v_color->val[v].raw[c] = (u8)(ca + (cb - ca) * t + 0.5f);
+	}
+	return (int)v;
+}
+
+/*
+ * One plane cuts a triangle into a polygon of at most four corners, kept in
+ * the winding of the triangle and fanned back into triangles. Returns the
+ * number of corners, zero when the triangle is behind the near plane or when
+ * the vertex set has no room left for the crossing points.
+ */
+static usize clip_triangle(
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	soa_entity_t *vertex_entity,
+	const int *triangle,
+	int *out_polygon)
+{
+	usize count = 0;
+	for (usize i = 0; i < 3; i++) {
+		const int a = triangle[i];
+		const int b = triangle[(i + 1) % 3];
+		const bool is_a_inside = v_position->z[a] >= camera_3d_near;
+		const bool is_b_inside = v_position->z[b] >= camera_3d_near;
+		if (is_a_inside) {
+			out_polygon[count++] = a;
+		}
+		if (is_a_inside != is_b_inside) {
+			if (vertex_entity->count >= SOA_LIMIT) {
+				return 0;
+			}
+			out_polygon[count++] = clip_edge(v_position, v_color, v_texcoord, vertex_entity, a, b);
+		}
+	}
+	return count;
+}
+
+/*
+ * Every four vertices are a quad split into the two triangles of
+ * soa_get_quad_index. After soa_apply_camera_3d they become the triangles of
+ * out_index. Triangles
+ * crossing the near plane are clipped, the crossing points are appended to the
+ * vertex set, then every vertex is divided by w. Triangles that end up wound
+ * the other way than the quads were built are facing away and dropped. The
+ * vertex z keeps the view depth.
+ */
+void soa_clip_triangles_3d(
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	soa_entity_t *vertex_entity,
+	soa_triangle_index *out_index)
+{
+	const int *quad_index = soa_get_quad_index();
+	const usize quad_count = vertex_entity->count / 4;
+	int *index = out_index->val;
+
+	usize count = 0;
+	for (usize q = 0; q < quad_count; q++) {
+		for (usize i = 0; i < 6; i += 3) {
+			const int triangle[3] = {
+				quad_index[q * 6 + i + 0],
+				quad_index[q * 6 + i + 1],
+				quad_index[q * 6 + i + 2],
+			};
+			const bool is_inside =
+				(v_position->z[triangle[0]] >= camera_3d_near) &
+				(v_position->z[triangle[1]] >= camera_3d_near) &
+				(v_position->z[triangle[2]] >= camera_3d_near);
+			if (is_inside) {
+				index[count + 0] = triangle[0];
+				index[count + 1] = triangle[1];
+				index[count + 2] = triangle[2];
+				count += 3;
+				continue;
+			}
+			int polygon[4];
+			const usize corner_count = clip_triangle(v_position, v_color, v_texcoord, vertex_entity,
+				triangle, polygon);
+			for (usize c = 2; c < corner_count; c++) {
+				index[count + 0] = polygon[0];
+				index[count + 1] = polygon[c - 1];
+				index[count + 2] = polygon[c];
+				count += 3;
+			}
+		}
+	}
+
+	/* Vertices behind the near plane divide too, no triangle uses them. */
+	const usize vertex_count = vertex_entity->count;
+	f32 *x = v_position->x;
+	f32 *y = v_position->y;
+	const f32 *w = v_position->z;
+	usize v = 0;
+#if SOA_MATH_WIDTH > 1
+	for (; v < soa_math_vector_count(vertex_count); v += SOA_MATH_WIDTH) {
+		const soa_f32xn vw = soa_xn_load(w + v);
+		soa_xn_store(x + v, soa_xn_div(soa_xn_load(x + v), vw));
+		soa_xn_store(y + v, soa_xn_div(soa_xn_load(y + v), vw));
+	}
+#endif
+	for (; v < vertex_count; v++) {
+		x[v] /= w[v];
+		y[v] /= w[v];
+	}
+
+	/* Quads are wound counter clockwise on screen, a negative area with y down. */
+	usize front_count = 0;
+	for (usize i = 0; i < count; i += 3) {
+		const int a = index[i + 0];
+		const int b = index[i + 1];
+		const int c = index[i + 2];
+		const f32 area =
+			(x[b] - x[a]) * (y[c] - y[a]) -
+			(y[b] - y[a]) * (x[c] - x[a]);
+		index[front_count + 0] = a;
+		index[front_count + 1] = b;
+		index[front_count + 2] = c;
+		front_count += (area < 0.f) * 3;
+	}
+	out_index->count = front_count;
+}
+
+/*
+ * Sprites stand on their position, centered on x. The bounds grow to (w + h)
+ * / 2 around the sprite center, which covers the half diagonal, so a sprite
+ * stays visible at any rotation. Empty sprites, like freed slots, are never
+ * visible. Lanes of out_mask are all ones for the visible sprites.
+ */
+void soa_get_visible_mask(
+	const f32 *x,
+	const f32 *y,
+	const f32 *width,
+	const f32 *height,
+	const usize count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	u32 *out_mask)
+{
+	usize i = 0;
+#if SOA_MATH_WIDTH > 1
+	const soa_f32xn zero = soa_xn_set1(0.f);
+	const soa_f32xn half = soa_xn_set1(0.5f);
+	const soa_f32xn camera_x = soa_xn_set1(camera.x);
+	const soa_f32xn camera_y = soa_xn_set1(camera.y);
+	const soa_f32xn viewport_x = soa_xn_set1(viewport.x);
+	const soa_f32xn viewport_y = soa_xn_set1(viewport.y);
+	for (; i < soa_math_vector_count(count); i += SOA_MATH_WIDTH) {
+		const soa_f32xn w = soa_xn_load(width + i);
+		const soa_f32xn h = soa_xn_load(height + i);
+		const soa_f32xn reach = soa_xn_mul(soa_xn_add(w, h), half);
+		const soa_f32xn px = soa_xn_sub(soa_xn_load(x + i), camera_x);
+		const soa_f32xn py = soa_xn_sub(soa_xn_sub(soa_xn_load(y + i), soa_xn_mul(h, half)), camera_y);
+		const soa_maskxn is_inside_x = soa_xn_and_mask(
+			soa_xn_less(zero, soa_xn_add(px, reach)), soa_xn_less(soa_xn_sub(px, reach), viewport_x));
+		const soa_maskxn is_inside_y = soa_xn_and_mask(
+			soa_xn_less(zero, soa_xn_add(py, reach)), soa_xn_less(soa_xn_sub(py, reach), viewport_y));
+		const soa_maskxn is_sized = soa_xn_and_mask(soa_xn_less(zero, w), soa_xn_less(zero, h));
+		soa_xn_store_mask(out_mask + i, soa_xn_and_mask(soa_xn_and_mask(is_inside_x, is_inside_y), is_sized));
+	}
+#endif
+	for (; i < count; i++) {
+		const f32 w = width[i];
+		const f32 h = height[i];
+		const f32 reach = (w + h) * 0.5f;
+		const f32 px = x[i] - camera.x;
+		const f32 py = (y[i] - h * 0.5f) - camera.y;
+		const bool is_visible = (px + reach > 0.f) & (px - reach < viewport.x) &
+					(py + reach > 0.f) & (py - reach < viewport.y) & (w > 0.f) & (h > 0.f);
+		out_mask[i] = is_visible ? 0xffffffffu : 0u;
+	}
+}
+
+/*
+ * The mask pass vectorizes, the compaction writes every slot and only moves
+ * past the visible ones.
+ */
+void soa_get_visible_slots(
+	const soa_position2 *e_position,
+	const soa_size2 *e_size,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	soa_slot_t *out_slots,
+	usize *out_count)
+{
+	if (entity_count == 0) {
+		*out_count = 0;
+		return;
+	}
+
+	f32 width[entity_count];
+	f32 height[entity_count];
+	u32 is_visible[entity_count];
+	soa_f16_load(width, e_size->w, entity_count);
+	soa_f16_load(height, e_size->h, entity_count);
+	soa_get_visible_mask(e_position->x, e_position->y, width, height, entity_count, camera, viewport,
+		is_visible);
 
+	usize count = 0;
 	for (usize e = 0; e < entity_count; e++) {
-		f32v4 pos = { e_position->x[e], e_position->y[e], e_position->z[e], 1.f };
-		f32v4 projected;
-		glm_mat4_mulv(mvp, pos.raw, projected.raw);
-		f32v2 ndc = {
-			projected.x / projected.w,
-			projected.y / projected.w,
-		};
-		f32v2 screen = {
-			(ndc.x + 1.f) * 0.5f * viewport.width,
-			(1.f - ndc.y) * 0.5f * viewport.height,
-		};
-		e_position->x[e] = screen.x;
-		e_position->y[e] = screen.y;
-		e_position->z[e] = projected.z;
+		out_slots[count] = (soa_slot_t){ e };
+		count += is_visible[e] & 1u;
 	}
+	*out_count = count;
 }
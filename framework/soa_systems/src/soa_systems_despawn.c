@@ -2,6 +2,7 @@
 #include <soa.h>
 #include <soa_components_health.h>
 #include <soa_components_movement.h>
+#include <soa_components_tilemap.h>
 #include <soa_components_transform.h>
 #include <soa_systems_despawn.h>
 
@@ -39,3 +40,21 @@ void soa_get_dead_despawn_slots(
 	}
 	*output_count = count;
 }
+
+void soa_get_raycast_blocked_despawn_slots(
+	const soa_raycast_hit *e_hit,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const f32seconds dt,
+	soa_slot_t *output,
+	usize *output_count)
+{
+	usize count = 0;
+	for (usize e = 0; e < entity_count; e++) {
+		const f32 step_distance = e_speed->val[e] * dt.seconds;
+		const bool is_blocked = e_hit->is_hit[e] && e_hit->distance[e] <= step_distance;
+		output[count] = (soa_slot_t){ e };
+		count += is_blocked;
+	}
+	*output_count = count;
+}
@@ -0,0 +1,37 @@
+#include <soa.h>
+#include <soa_components_damage.h>
+#include <soa_components_health.h>
+#include <soa_systems_explosion.h>
+
+void soa_get_exploding_slots(
+	const soa_health *e_health,
+	const soa_entity_t *entity,
+	soa_slot_t *output,
+	usize *output_count)
+{
+	/* Freed slots keep their health, only occupied ones may explode. */
+	usize count = 0;
+	for (usize e = 0; e < entity->count; e++) {
+		const bool is_exploding = entity->is_occupied[e] && e_health->val[e] <= 0.f;
+		output[count] = (soa_slot_t){ e };
+		count += is_exploding;
+	}
+	*output_count = count;
+}
+
+void soa_explosion_damages_something(
+	soa_health *s_health,
+	const soa_damage *x_damage,
+	const f32 radius,
+	const soa_slot_t *something_slots,
+	const soa_slot_t *explosion_slots,
+	const f32 *distances,
+	const usize slots_count)
+{
+	for (usize i = 0; i < slots_count; i++) {
+		const usize s = something_slots[i].idx;
+		const usize x = explosion_slots[i].idx;
+		const f32 falloff = 1.f - distances[i] / radius;
+		s_health->val[s] -= x_damage->val[x] * (falloff > 0.f ? falloff : 0.f);
+	}
+}
@@ -1,27 +1,167 @@
 #include <math.h>
+#include <math/soa_fixed.h>
+#include <math/soa_math.h>
 #include <soa.h>
+#include <soa_components_animation.h>
 #include <soa_components_movement.h>
 #include <soa_components_physics.h>
+#include <soa_components_spatial.h>
 #include <soa_components_transform.h>
+#include <soa_systems_animation.h>
 #include <soa_systems_movement.h>
+#include <soa_systems_spatial.h>
 
+enum {
+	MOVE_CHUNK = 256,
+};
+
+#ifdef SOA_DETERMINISTIC
+/* The same Q16.16 steps as integrate_chunk, added onto the velocity. */
 void soa_movement_to_velocity(
 	const soa_movement2 *e_movement,
 	const soa_speed *e_speed,
 	soa_velocity2 *e_velocity,
 	const usize entity_count)
 {
-	for (usize e = 0; e < entity_count; e++) {
-		const f32 x = e_movement->x[e];
-		const f32 y = e_movement->y[e];
-		const f32 length = sqrtf(x * x + y * y);
-		const f32 dir_x = length != 0.f ? x / length : 0.f;
-		const f32 dir_y = length != 0.f ? y / length : 0.f;
+	for (usize begin = 0; begin < entity_count; begin += MOVE_CHUNK) {
+		const usize count = begin + MOVE_CHUNK < entity_count ? MOVE_CHUNK : entity_count - begin;
+		q16 movement_x[MOVE_CHUNK];
+		q16 movement_y[MOVE_CHUNK];
+		q16 speed[MOVE_CHUNK];
+		q16 velocity_x[MOVE_CHUNK];
+		q16 velocity_y[MOVE_CHUNK];
+		q16 dir_x[MOVE_CHUNK];
+		q16 dir_y[MOVE_CHUNK];
+		soa_q16_from_f32(movement_x, e_movement->x + begin, count);
+		soa_q16_from_f32(movement_y, e_movement->y + begin, count);
+		soa_q16_from_f32(speed, e_speed->val + begin, count);
+		soa_q16_from_f32(velocity_x, e_velocity->x + begin, count);
+		soa_q16_from_f32(velocity_y, e_velocity->y + begin, count);
+
+		soa_q16_normalize2(dir_x, dir_y, movement_x, movement_y, count);
+		soa_q16_mul(dir_x, dir_x, speed, count);
+		soa_q16_mul(dir_y, dir_y, speed, count);
+		soa_q16_add_scaled(velocity_x, velocity_x, dir_x, SOA_Q16_ONE, count);
+		soa_q16_add_scaled(velocity_y, velocity_y, dir_y, SOA_Q16_ONE, count);
+
+		soa_f32_from_q16(e_velocity->x + begin, velocity_x, count);
+		soa_f32_from_q16(e_velocity->y + begin, velocity_y, count);
+	}
+}
+#else
+void soa_movement_to_velocity(
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	soa_velocity2 *e_velocity,
+	const usize entity_count)
+{
+	f32 dir_x[entity_count];
+	f32 dir_y[entity_count];
+	soa_f32_normalize2(dir_x, dir_y, e_movement->x, e_movement->y, entity_count);
+	soa_f32_mul_add(e_velocity->x, e_velocity->x, dir_x, e_speed->val, entity_count);
+	soa_f32_mul_add(e_velocity->y, e_velocity->y, dir_y, e_speed->val, entity_count);
+}
+#endif
+
+#ifdef SOA_DETERMINISTIC
+/*
+ * Deterministic builds run the integration in Q16.16 and round back to f32,
+ * so every compiler stores the same bits whatever it vectorizes or contracts.
+ */
+static void integrate_chunk(
+	soa_position2 *e_position,
+	soa_velocity2 *e_velocity,
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	const usize begin,
+	const usize count,
+	const f32seconds dt)
+{
+	q16 movement_x[MOVE_CHUNK];
+	q16 movement_y[MOVE_CHUNK];
+	q16 speed[MOVE_CHUNK];
+	q16 position_x[MOVE_CHUNK];
+	q16 position_y[MOVE_CHUNK];
+	q16 velocity_x[MOVE_CHUNK];
+	q16 velocity_y[MOVE_CHUNK];
+	q16 step;
+	soa_q16_from_f32(movement_x, e_movement->x + begin, count);
+	soa_q16_from_f32(movement_y, e_movement->y + begin, count);
+	soa_q16_from_f32(speed, e_speed->val + begin, count);
+	soa_q16_from_f32(position_x, e_position->x + begin, count);
+	soa_q16_from_f32(position_y, e_position->y + begin, count);
+	soa_q16_from_f32(&step, &dt.seconds, 1);
+
+	soa_q16_normalize2(velocity_x, velocity_y, movement_x, movement_y, count);
+	soa_q16_mul(velocity_x, velocity_x, speed, count);
+	soa_q16_mul(velocity_y, velocity_y, speed, count);
+	soa_q16_add_scaled(position_x, position_x, velocity_x, step, count);
+	soa_q16_add_scaled(position_y, position_y, velocity_y, step, count);
+
+	soa_f32_from_q16(e_velocity->x + begin, velocity_x, count);
+	soa_f32_from_q16(e_velocity->y + begin, velocity_y, count);
+	soa_f32_from_q16(e_position->x + begin, position_x, count);
+	soa_f32_from_q16(e_position->y + begin, position_y, count);
+}
+#else
+static void integrate_chunk(
+	soa_position2 *e_position,
+	soa_velocity2 *e_velocity,
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	const usize begin,
+	const usize count,
+	const f32seconds dt)
+{
+	f32 dir_x[MOVE_CHUNK];
+	f32 dir_y[MOVE_CHUNK];
+	soa_f32_normalize2(dir_x, dir_y, e_movement->x + begin, e_movement->y + begin, count);
+
+	for (usize i = 0; i < count; i++) {
+		const usize e = begin + i;
 		const f32 speed = e_speed->val[e];
-		e_velocity->x[e] += dir_x * speed;
-		e_velocity->y[e] += dir_y * speed;
+		const f32 velocity_x = dir_x[i] * speed;
+		const f32 velocity_y = dir_y[i] * speed;
+		e_velocity->x[e] = velocity_x;
+		e_velocity->y[e] = velocity_y;
+		e_position->x[e] += velocity_x * dt.seconds;
+		e_position->y[e] += velocity_y * dt.seconds;
 	}
 }
+#endif
+
+/*
+ * Fused reset, movement to velocity and forwards integration. Chunks are small
+ * enough for the directions to stay in L1 and velocity is only stored once,
+ * the separate systems stream every column through memory once per pass.
+ */
+void soa_move(
+	soa_position2 *e_position,
+	soa_velocity2 *e_velocity,
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const f32seconds dt)
+{
+	for (usize begin = 0; begin < entity_count; begin += MOVE_CHUNK) {
+		const usize count = begin + MOVE_CHUNK < entity_count ? MOVE_CHUNK : entity_count - begin;
+		integrate_chunk(e_position, e_velocity, e_movement, e_speed, begin, count, dt);
+	}
+}
+
+/* The animation pass only touches the phases on ticks where the clock moves. */
+void soa_move_and_animate(
+	soa_position2 *e_position,
+	soa_velocity2 *e_velocity,
+	soa_animation *e_animation,
+	const soa_movement2 *e_movement,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const f32seconds dt)
+{
+	soa_move(e_position, e_velocity, e_movement, e_speed, entity_count, dt);
+	soa_progress_animation_if_moving(e_animation, e_velocity, entity_count, dt);
+}
 
 void soa_follow_one_target(
 	soa_movement2 *f_movement,
@@ -44,14 +184,130 @@ void soa_follow_one_target(
 	}
 }
 
+void soa_follow_nearest_target(
+	soa_movement2 *f_movement,
+	const soa_position2 *f_position,
+	const soa_speed *f_speed,
+	const usize follower_count,
+	const soa_position2 *t_position,
+	const soa_spatial_grid *t_grid)
+{
+	soa_slot_t nearest[follower_count];
+	u8bool found[follower_count];
+	soa_find_nearest_in_spatial_grid(f_position, follower_count, t_grid, nearest, found);
+
+#pragma omp parallel for if (follower_count > 256) schedule(static, 256)
+	for (usize f = 0; f < follower_count; f++) {
+		const usize t = nearest[f].idx;
+		const f32 target_x = t_position->x[t];
+		const f32 target_y = t_position->y[t];
+		const f32 follower_x = f_position->x[f];
+		const f32 follower_y = f_position->y[f];
+		const f32 speed = found[f] ? f_speed->val[f] : 0.f;
+		f_movement->x[f] = follower_x > target_x ? -speed : follower_x < target_x ? speed : f_movement->x[f];
+		f_movement->y[f] = follower_y > target_y ? -speed : follower_y < target_y ? speed : f_movement->y[f];
+	}
+}
+
+static i32 clamp_cell(
+	const f32 position,
+	const f32 origin,
+	const f32 cell_size,
+	const u32 cell_count)
+{
+	const f32 cell = floorf((position - origin) / cell_size);
+	const f32 last = (f32)cell_count - 1.f;
+	return (i32)(cell < 0.f ? 0.f : cell > last ? last : cell);
+}
+
+/*
+ * Every entity is pushed away from the neighbours found in the grid cells
+ * that overlap its radius. The push of a neighbour fades out at the radius
+ * and grows as 1 / distance up close, which keeps the inner loop free of
+ * square roots. Neighbours on the exact same position are told apart by
+ * slot order so that stacked entities still split up. Deterministic builds
+ * keep the pushes summed one neighbour at a time in grid order, a vector
+ * reduction would regroup the sum by the vector width.
+ */
+void soa_separate_from_neighbours(
+	soa_movement2 *e_movement,
+	const soa_position2 *e_position,
+	const soa_speed *e_speed,
+	const usize entity_count,
+	const soa_spatial_grid *e_grid,
+	const f32 radius)
+{
+	if (e_grid->count == 0) {
+		return;
+	}
+
+	const f32 radius2 = radius * radius;
+	const f32 inv_radius2 = 1.f / radius2;
+	const f32 *grid_x = e_grid->x;
+	const f32 *grid_y = e_grid->y;
+	const soa_slot_t *grid_slot = e_grid->slot;
+
+#pragma omp parallel for if (entity_count > 256) schedule(static, 256)
+	for (usize e = 0; e < entity_count; e++) {
+		const f32 x = e_position->x[e];
+		const f32 y = e_position->y[e];
+		const i32 x0 = clamp_cell(x - radius, e_grid->origin.x, e_grid->cell_size, e_grid->width);
+		const i32 x1 = clamp_cell(x + radius, e_grid->origin.x, e_grid->cell_size, e_grid->width);
+		const i32 y0 = clamp_cell(y - radius, e_grid->origin.y, e_grid->cell_size, e_grid->height);
+		const i32 y1 = clamp_cell(y + radius, e_grid->origin.y, e_grid->cell_size, e_grid->height);
+
+		f32 push_x = 0.f;
+		f32 push_y = 0.f;
+		for (i32 cy = y0; cy <= y1; cy++) {
+			/* Cells of a row are contiguous, walk them as one range. */
+			const usize row = (usize)cy * e_grid->width;
+			const u32 begin = e_grid->cell_start[row + (usize)x0];
+			const u32 end = e_grid->cell_start[row + (usize)x1 + 1];
+#ifndef SOA_DETERMINISTIC
+#pragma omp simd reduction(+:push_x, push_y)
+#endif
+			for (u32 i = begin; i < end; i++) {
+				const f32 dx = x - grid_x[i];
+				const f32 dy = y - grid_y[i];
+				const f32 distance2 = dx * dx + dy * dy;
+				const bool is_self = grid_slot[i].idx == e;
+				const bool is_stacked = distance2 == 0.f && !is_self;
+				const bool is_near = distance2 > 0.f && distance2 < radius2;
+				const f32 weight = is_near ? (1.f / distance2 - inv_radius2) * radius : 0.f;
+				const f32 stacked_x = grid_slot[i].idx < e ? 1.f : -1.f;
+				push_x += is_stacked ? stacked_x : dx * weight;
+				push_y += dy * weight;
+			}
+		}
+
+		const f32 speed = e_speed->val[e];
+		e_movement->x[e] += push_x * speed;
+		e_movement->y[e] += push_y * speed;
+	}
+}
+
 void soa_forward_movement_from_rotation(
 	soa_movement2 *e_movement,
 	const soa_rotation1 *e_rotation,
 	const usize entity_count)
 {
+	f32 rotation[entity_count];
+	f32 sin[entity_count];
+	f32 cos[entity_count];
+	soa_f16_load(rotation, e_rotation->x, entity_count);
+#ifdef SOA_DETERMINISTIC
+	q16 fixed_rotation[entity_count];
+	q16 fixed_sin[entity_count];
+	q16 fixed_cos[entity_count];
+	soa_q16_from_f32(fixed_rotation, rotation, entity_count);
+	soa_q16_sincos(fixed_sin, fixed_cos, fixed_rotation, entity_count);
+	soa_f32_from_q16(sin, fixed_sin, entity_count);
+	soa_f32_from_q16(cos, fixed_cos, entity_count);
+#else
+	soa_f32_sincos(sin, cos, rotation, entity_count);
+#endif
 	for (usize e = 0; e < entity_count; e++) {
-		const f32 rad = e_rotation->x[e];
-		e_movement->x[e] = -cosf(rad);
-		e_movement->y[e] = -sinf(rad);
+		e_movement->x[e] = -cos[e];
+		e_movement->y[e] = -sin[e];
 	}
 }
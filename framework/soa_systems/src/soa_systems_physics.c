@@ -1,6 +1,9 @@
+#include <math/soa_fixed.h>
 #include <soa_components_physics.h>
+#include <soa_components_spatial.h>
 #include <soa_components_transform.h>
 #include <soa_systems_physics.h>
+#include <soa_systems_spatial.h>
 
 void soa_reset_velocity(
 	soa_velocity2 *e_velocity,
@@ -12,14 +15,380 @@ void soa_reset_velocity(
 	}
 }
 
+enum {
+	PHYSICS_CHUNK = 256,
+};
+
+#ifdef SOA_DETERMINISTIC
+/* Deterministic builds integrate in Q16.16 and round back, like soa_move. */
+static void integrate_forwards(
+	f32 *x,
+	f32 *y,
+	const soa_velocity2 *e_velocity,
+	const usize entity_count,
+	const f32seconds dt)
+{
+	q16 step;
+	soa_q16_from_f32(&step, &dt.seconds, 1);
+	for (usize begin = 0; begin < entity_count; begin += PHYSICS_CHUNK) {
+		const usize count = begin + PHYSICS_CHUNK < entity_count ? PHYSICS_CHUNK : entity_count - begin;
+		q16 position_x[PHYSICS_CHUNK];
+		q16 position_y[PHYSICS_CHUNK];
+		q16 velocity_x[PHYSICS_CHUNK];
+		q16 velocity_y[PHYSICS_CHUNK];
+		soa_q16_from_f32(position_x, x + begin, count);
+		soa_q16_from_f32(position_y, y + begin, count);
+		soa_q16_from_f32(velocity_x, e_velocity->x + begin, count);
+		soa_q16_from_f32(velocity_y, e_velocity->y + begin, count);
+		soa_q16_add_scaled(position_x, position_x, velocity_x, step, count);
+		soa_q16_add_scaled(position_y, position_y, velocity_y, step, count);
+		soa_f32_from_q16(x + begin, position_x, count);
+		soa_f32_from_q16(y + begin, position_y, count);
+	}
+}
+
+static void scale_velocity(
+	soa_velocity2 *e_velocity,
+	const usize entity_count,
+	const f32 factor)
+{
+	q16 scale;
+	soa_q16_from_f32(&scale, &factor, 1);
+	for (usize begin = 0; begin < entity_count; begin += PHYSICS_CHUNK) {
+		const usize count = begin + PHYSICS_CHUNK < entity_count ? PHYSICS_CHUNK : entity_count - begin;
+		q16 velocity_x[PHYSICS_CHUNK];
+		q16 velocity_y[PHYSICS_CHUNK];
+		soa_q16_from_f32(velocity_x, e_velocity->x + begin, count);
+		soa_q16_from_f32(velocity_y, e_velocity->y + begin, count);
+		soa_q16_scale(velocity_x, velocity_x, scale, count);
+		soa_q16_scale(velocity_y, velocity_y, scale, count);
+		soa_f32_from_q16(e_velocity->x + begin, velocity_x, count);
+		soa_f32_from_q16(e_velocity->y + begin, velocity_y, count);
+	}
+}
+#else
+static void integrate_forwards(
+	f32 *x,
+	f32 *y,
+	const soa_velocity2 *e_velocity,
+	const usize entity_count,
+	const f32seconds dt)
+{
+	for (usize e = 0; e < entity_count; e++) {
+		x[e] += e_velocity->x[e] * dt.seconds;
+		y[e] += e_velocity->y[e] * dt.seconds;
+	}
+}
+
+static void scale_velocity(
+	soa_velocity2 *e_velocity,
+	const usize entity_count,
+	const f32 factor)
+{
+	for (usize e = 0; e < entity_count; e++) {
+		e_velocity->x[e] *= factor;
+		e_velocity->y[e] *= factor;
+	}
+}
+#endif
+
 void soa_apply_forwards_velocity(
 	soa_position2 *e_position,
 	const soa_velocity2 *e_velocity,
 	const usize entity_count,
 	const f32seconds dt)
 {
-	for (usize e = 0; e < entity_count; e++) {
-		e_position->x[e] += e_velocity->x[e] * dt.seconds;
-		e_position->y[e] += e_velocity->y[e] * dt.seconds;
+	integrate_forwards(e_position->x, e_position->y, e_velocity, entity_count, dt);
+}
+
+/* Only moves the offsets, soa_renormalize_lwc_position2 carries them over. */
+void soa_apply_forwards_velocity_lwc(
+	soa_lwc_position2 *e_position,
+	const soa_velocity2 *e_velocity,
+	const usize entity_count,
+	const f32seconds dt)
+{
+	integrate_forwards(e_position->x, e_position->y, e_velocity, entity_count, dt);
+}
+
+/*
+ * Appends the (a, b, distance) triples of a radius query as circle contacts.
+ * Within one set every pair is found twice and every slot finds itself, only
+ * the pairs with a < b are kept. Contacts past the limit are dropped.
+ */
+void soa_add_contacts(
+	soa_contact2 *contacts,
+	const soa_position2 *a_position,
+	const soa_weight *a_weight,
+	const soa_position2 *b_position,
+	const soa_weight *b_weight,
+	const soa_slot_t *a_slots,
+	const soa_slot_t *b_slots,
+	const f32 *distances,
+	const usize pair_count,
+	const f32 radius,
+	const bool is_same_set)
+{
+	usize count = contacts->count;
+	for (usize i = 0; i < pair_count && count < SOA_CONTACT_LIMIT; i++) {
+		const usize a = a_slots[i].idx;
+		const usize b = b_slots[i].idx;
+		const f32 distance = distances[i];
+		const f32 ma = a_weight->kg[a];
+		const f32 mb = b_weight->kg[b];
+		/* Bodies on top of each other are pushed apart along x. */
+		const bool is_apart = distance > 0.f;
+		const f32 inv_distance = is_apart ? 1.f / distance : 0.f;
+		contacts->a[count] = a_slots[i];
+		contacts->b[count] = b_slots[i];
+		contacts->normal_x[count] = is_apart ? (b_position->x[b] - a_position->x[a]) * inv_distance : 1.f;
+		contacts->normal_y[count] = (b_position->y[b] - a_position->y[a]) * inv_distance;
+		contacts->depth[count] = radius - distance;
+		contacts->inv_mass_a[count] = ma > 0.f ? 1.f / ma : 0.f;
+		contacts->inv_mass_b[count] = mb > 0.f ? 1.f / mb : 0.f;
+		count += !is_same_set || a < b;
+	}
+	contacts->count = count;
+}
+
+#ifdef SOA_DETERMINISTIC
+/*
+ * Deterministic builds iterate in Q16.16 on copies of the touched velocities.
+ * The impulse is kept as the change of separating velocity, split between the
+ * two bodies by their part of the inverse mass, which leaves no division in
+ * the loop and no impulse that outgrows the Q16.16 range on heavy bodies.
+ */
+static void iterate_contacts(
+	const soa_contact2 *contacts,
+	const f32 *share,
+	soa_velocity2 *a_velocity,
+	soa_velocity2 *b_velocity,
+	const usize iterations,
+	const f32 bias,
+	const f32 slop)
+{
+	const usize count = contacts->count;
+	f32 target[count];
+	f32 part_a[count];
+	f32 part_b[count];
+	for (usize c = 0; c < count; c++) {
+		const f32 overlap = contacts->depth[c] - slop;
+		const f32 inv_mass = contacts->inv_mass_a[c] + contacts->inv_mass_b[c];
+		target[c] = overlap > 0.f ? overlap * bias : 0.f;
+		part_a[c] = inv_mass > 0.f ? contacts->inv_mass_a[c] / inv_mass : 0.f;
+		part_b[c] = inv_mass > 0.f ? contacts->inv_mass_b[c] / inv_mass : 0.f;
+	}
+	q16 normal_x[count];
+	q16 normal_y[count];
+	q16 fixed_target[count];
+	q16 fixed_share[count];
+	q16 fixed_part_a[count];
+	q16 fixed_part_b[count];
+	q16 impulse[count];
+	soa_q16_from_f32(normal_x, contacts->normal_x, count);
+	soa_q16_from_f32(normal_y, contacts->normal_y, count);
+	soa_q16_from_f32(fixed_target, target, count);
+	soa_q16_from_f32(fixed_share, share, count);
+	soa_q16_from_f32(fixed_part_a, part_a, count);
+	soa_q16_from_f32(fixed_part_b, part_b, count);
+
+	q16 velocity[4][SOA_LIMIT];
+	q16 *a_x = velocity[0];
+	q16 *a_y = velocity[1];
+	q16 *b_x = a_velocity == b_velocity ? velocity[0] : velocity[2];
+	q16 *b_y = a_velocity == b_velocity ? velocity[1] : velocity[3];
+	for (usize c = 0; c < count; c++) {
+		const usize a = contacts->a[c].idx;
+		const usize b = contacts->b[c].idx;
+		soa_q16_from_f32(&a_x[a], &a_velocity->x[a], 1);
+		soa_q16_from_f32(&a_y[a], &a_velocity->y[a], 1);
+		soa_q16_from_f32(&b_x[b], &b_velocity->x[b], 1);
+		soa_q16_from_f32(&b_y[b], &b_velocity->y[b], 1);
+	}
+
+	for (usize it = 0; it < iterations; it++) {
+#pragma omp parallel for if (count > 256) schedule(static, 256)
+		for (usize c = 0; c < count; c++) {
+			const usize a = contacts->a[c].idx;
+			const usize b = contacts->b[c].idx;
+			const q16 dvx = b_x[b] - a_x[a];
+			const q16 dvy = b_y[b] - a_y[a];
+			const q16 separating = soa_q16_mul1(dvx, normal_x[c]) + soa_q16_mul1(dvy, normal_y[c]);
+			const q16 change = soa_q16_mul1(fixed_target[c] - separating, fixed_share[c]);
+			impulse[c] = change > 0 ? change : 0;
+		}
+		for (usize c = 0; c < count; c++) {
+			const usize a = contacts->a[c].idx;
+			const usize b = contacts->b[c].idx;
+			const q16 ja = soa_q16_mul1(impulse[c], fixed_part_a[c]);
+			const q16 jb = soa_q16_mul1(impulse[c], fixed_part_b[c]);
+			a_x[a] -= soa_q16_mul1(ja, normal_x[c]);
+			a_y[a] -= soa_q16_mul1(ja, normal_y[c]);
+			b_x[b] += soa_q16_mul1(jb, normal_x[c]);
+			b_y[b] += soa_q16_mul1(jb, normal_y[c]);
+		}
+	}
+
+	for (usize c = 0; c < count; c++) {
+		const usize a = contacts->a[c].idx;
+		const usize b = contacts->b[c].idx;
+		soa_f32_from_q16(&a_velocity->x[a], &a_x[a], 1);
+		soa_f32_from_q16(&a_velocity->y[a], &a_y[a], 1);
+		soa_f32_from_q16(&b_velocity->x[b], &b_x[b], 1);
+		soa_f32_from_q16(&b_velocity->y[b], &b_y[b], 1);
+	}
+}
+#else
+static void iterate_contacts(
+	const soa_contact2 *contacts,
+	const f32 *share,
+	soa_velocity2 *a_velocity,
+	soa_velocity2 *b_velocity,
+	const usize iterations,
+	const f32 bias,
+	const f32 slop)
+{
+	const usize count = contacts->count;
+	f32 impulse[count];
+	for (usize it = 0; it < iterations; it++) {
+#pragma omp parallel for if (count > 256) schedule(static, 256)
+		for (usize c = 0; c < count; c++) {
+			const usize a = contacts->a[c].idx;
+			const usize b = contacts->b[c].idx;
+			const f32 nx = contacts->normal_x[c];
+			const f32 ny = contacts->normal_y[c];
+			const f32 inv_mass = contacts->inv_mass_a[c] + contacts->inv_mass_b[c];
+			const f32 dvx = b_velocity->x[b] - a_velocity->x[a];
+			const f32 dvy = b_velocity->y[b] - a_velocity->y[a];
+			const f32 separating = dvx * nx + dvy * ny;
+			const f32 overlap = contacts->depth[c] - slop;
+			const f32 target = overlap > 0.f ? overlap * bias : 0.f;
+			const f32 lambda = (target - separating) * share[c] / inv_mass;
+			impulse[c] = inv_mass > 0.f && lambda > 0.f ? lambda : 0.f;
+		}
+		for (usize c = 0; c < count; c++) {
+			const usize a = contacts->a[c].idx;
+			const usize b = contacts->b[c].idx;
+			const f32 ja = impulse[c] * contacts->inv_mass_a[c];
+			const f32 jb = impulse[c] * contacts->inv_mass_b[c];
+			a_velocity->x[a] -= ja * contacts->normal_x[c];
+			a_velocity->y[a] -= ja * contacts->normal_y[c];
+			b_velocity->x[b] += jb * contacts->normal_x[c];
+			b_velocity->y[b] += jb * contacts->normal_y[c];
+		}
+	}
+}
+#endif
+
+/*
+ * Jacobi iterations over the contacts: every contact computes its impulse
+ * from the velocities of the previous iteration, then all of them are applied
+ * at once. The first loop has no write conflicts, so it runs in parallel
+ * without colouring the contact graph, only the scatter is serial. A body in
+ * n contacts would receive n full impulses, so each impulse is divided by the
+ * contact count of the busier of its two bodies. The target separating
+ * velocity pushes out a fraction of the overlap each step, contacts that
+ * already separate get no impulse.
+ */
+void soa_solve_contacts(
+	const soa_contact2 *contacts,
+	soa_velocity2 *a_velocity,
+	soa_velocity2 *b_velocity,
+	const usize iterations,
+	const f32seconds dt)
+{
+	const usize count = contacts->count;
+	if (count == 0) {
+		return;
+	}
+	const f32 bias = 0.2f / dt.seconds;
+	const f32 slop = 0.5f;
+	f32 share[count];
+
+	/* Within one set both ends of a contact count towards the same bodies. */
+	u32 counts[2][SOA_LIMIT];
+	u32 *a_counts = counts[0];
+	u32 *b_counts = a_velocity == b_velocity ? counts[0] : counts[1];
+	for (usize c = 0; c < count; c++) {
+		a_counts[contacts->a[c].idx] = 0;
+		b_counts[contacts->b[c].idx] = 0;
+	}
+	for (usize c = 0; c < count; c++) {
+		a_counts[contacts->a[c].idx]++;
+		b_counts[contacts->b[c].idx]++;
 	}
+	for (usize c = 0; c < count; c++) {
+		const u32 na = a_counts[contacts->a[c].idx];
+		const u32 nb = b_counts[contacts->b[c].idx];
+		share[c] = 1.f / (f32)(na > nb ? na : nb);
+	}
+
+	iterate_contacts(contacts, share, a_velocity, b_velocity, iterations, bias, slop);
+}
+
+/*
+ * Bodies of a closer than radius to bodies of b are pushed apart through
+ * their knockback. The grid slots of a are the queries, in batches that fit
+ * the hit buffers, until every query ran or the contact set is full. a and b
+ * can be the same set, each pair is then solved once.
+ */
+void soa_push_apart(
+	soa_contact2 *contacts,
+	const soa_position2 *a_position,
+	const soa_weight *a_weight,
+	soa_velocity2 *a_knockback,
+	const soa_spatial_grid *a_grid,
+	const soa_position2 *b_position,
+	const soa_weight *b_weight,
+	soa_velocity2 *b_knockback,
+	const soa_spatial_grid *b_grid,
+	const f32 radius,
+	const usize iterations,
+	const f32seconds dt)
+{
+	soa_slot_t hit_as[SOA_LIMIT];
+	soa_slot_t hit_bs[SOA_LIMIT];
+	f32 hit_distances[SOA_LIMIT];
+	const bool is_same_set = a_position == b_position;
+
+	contacts->count = 0;
+	usize done = 0;
+	while (done < a_grid->count && contacts->count < SOA_CONTACT_LIMIT) {
+		usize hit_count;
+		usize query_count;
+		soa_find_in_radius_in_spatial_grid(a_position, a_grid->slot + done, a_grid->count - done, radius,
+			b_grid, SOA_LIMIT, hit_as, hit_bs, hit_distances, &hit_count, &query_count);
+		soa_add_contacts(contacts, a_position, a_weight, b_position, b_weight,
+			hit_as, hit_bs, hit_distances, hit_count, radius, is_same_set);
+		done += query_count;
+	}
+	soa_solve_contacts(contacts, a_knockback, b_knockback, iterations, dt);
+}
+
+/* Knockback is a velocity on top of movement that dies out over time. */
+void soa_apply_knockback(
+	soa_position2 *e_position,
+	soa_velocity2 *e_knockback,
+	const usize entity_count,
+	const f32 damping,
+	const f32seconds dt)
+{
+	const f32 decay = 1.f - damping * dt.seconds;
+	const f32 factor = decay > 0.f ? decay : 0.f;
+	integrate_forwards(e_position->x, e_position->y, e_knockback, entity_count, dt);
+	scale_velocity(e_knockback, entity_count, factor);
+}
+
+/* Same as soa_apply_knockback, soa_renormalize_lwc_position2 carries the offsets over. */
+void soa_apply_knockback_lwc(
+	soa_lwc_position2 *e_position,
+	soa_velocity2 *e_knockback,
+	const usize entity_count,
+	const f32 damping,
+	const f32seconds dt)
+{
+	const f32 decay = 1.f - damping * dt.seconds;
+	const f32 factor = decay > 0.f ? decay : 0.f;
+	soa_apply_forwards_velocity_lwc(e_position, e_knockback, entity_count, dt);
+	scale_velocity(e_knockback, entity_count, factor);
 }
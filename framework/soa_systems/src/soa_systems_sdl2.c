@@ -1,15 +1,21 @@
+#include <SDL2/SDL_log.h>
 #include <SDL2/SDL_render.h>
 #include <math/math_helpers.h>
+#include <math/soa_math.h>
 #include <soa.h>
 #include <soa_components_color.h>
 #include <soa_components_graphics.h>
 #include <soa_components_sdl2.h>
 #include <soa_components_shape.h>
 #include <soa_components_transform.h>
+#include <soa_components_vertex.h>
+#include <soa_systems_camera.h>
 #include <soa_systems_sdl2.h>
+#include <soa_systems_vertex.h>
 #include <tilemap.h>
 
-void soa_make_sdl2_vertex(
+/* Returns how many vertices fit, the rest are dropped. */
+usize soa_make_sdl2_vertex(
 	const soa_position2 *e_position,
 	const soa_color1 *e_color,
 	const soa_texcoord *e_texcoord,
@@ -17,14 +23,15 @@ void soa_make_sdl2_vertex(
 	soa_sdl2_vertex *to_vertex,
 	soa_entity_t *to_entity)
 {
-	for (usize e = 0; e < entity_count; e++) {
-		const usize t = soa_new_slot1(to_entity).idx;
-		to_vertex->val[t] = (SDL_Vertex) {
+	const soa_slot_range_t range = soa_new_slots(to_entity, entity_count);
+	for (usize e = 0; e < range.count; e++) {
+		to_vertex->val[range.idx + e] = (SDL_Vertex) {
 			.position = { e_position->x[e], e_position->y[e] },
 			.color = { e_color->val[e].r, e_color->val[e].g, e_color->val[e].b, e_color->val[e].a },
 			.tex_coord = { e_texcoord->s[e], e_texcoord->t[e] },
 		};
 	}
+	return range.count;
 }
 
 void soa_draw_geometry(
@@ -36,6 +43,62 @@ void soa_draw_geometry(
 	SDL_RenderGeometry(renderer, texture, e_vertex->val, entity_count, NULL, 0);
 }
 
+/*
+ * Submits the vertex columns without building SDL_Vertex. Colors are passed
+ * straight from their column, only the x y and s t pairs are zipped because
+ * SDL wants each attribute as one strided array.
+ */
+static void draw_geometry_raw(
+	const soa_position3 *v_position,
+	const soa_color1 *v_color,
+	const soa_texcoord *v_texcoord,
+	const usize vertex_count,
+	const int *index,
+	const usize index_count,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture)
+{
+	if (vertex_count == 0 || index_count == 0) {
+		return;
+	}
+	f32 xy[2 * vertex_count];
+	f32 uv[2 * vertex_count];
+	soa_f32_interleave2(xy, v_position->x, v_position->y, vertex_count);
+	soa_f32_interleave2(uv, v_texcoord->s, v_texcoord->t, vertex_count);
+	SDL_RenderGeometryRaw(renderer, texture,
+		xy, 2 * sizeof(f32),
+		(const SDL_Color *)v_color->val, sizeof(u8v4),
+		uv, 2 * sizeof(f32),
+		(int)vertex_count, index, (int)index_count, sizeof(int));
+}
+
+/* Vertices come four per quad, a trailing partial quad is left out. */
+void soa_draw_quads_raw(
+	const soa_position3 *v_position,
+	const soa_color1 *v_color,
+	const soa_texcoord *v_texcoord,
+	const usize vertex_count,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture)
+{
+	const usize quad_count = vertex_count / 4;
+	draw_geometry_raw(v_position, v_color, v_texcoord, vertex_count,
+		soa_get_quad_index(), quad_count * 6, renderer, texture);
+}
+
+void soa_draw_triangles_raw(
+	const soa_position3 *v_position,
+	const soa_color1 *v_color,
+	const soa_texcoord *v_texcoord,
+	const usize vertex_count,
+	const soa_triangle_index *triangle_index,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture)
+{
+	draw_geometry_raw(v_position, v_color, v_texcoord, vertex_count,
+		triangle_index->val, triangle_index->count, renderer, texture);
+}
+
 void soa_draw_sprite(
 	const soa_position2 *e_position,
 	const soa_size2 *e_size,
@@ -43,20 +106,28 @@ void soa_draw_sprite(
 	const usize entity_count,
 	SDL_Renderer *renderer,
 	SDL_Texture *texture,
-	const f32v2 camera)
+	const f32v2 camera,
+	const f32v2 viewport)
 {
-	for (usize e = 0; e < entity_count; e++) {
+	soa_slot_t visible[entity_count];
+	usize visible_count;
+	soa_get_visible_slots(e_position, e_size, entity_count, camera, viewport, visible, &visible_count);
+
+	for (usize i = 0; i < visible_count; i++) {
+		const usize e = visible[i].idx;
 		const SDL_Rect srcrect = {
 			e_clip->x[e],
 			e_clip->y[e],
 			e_clip->w[e],
 			e_clip->h[e],
 		};
+		const f32 w = soa_f16_to_f32(e_size->w[e]);
+		const f32 h = soa_f16_to_f32(e_size->h[e]);
 		const SDL_FRect origrect = {
-			e_position->x[e] - e_size->w[e] * 0.5f,
-			e_position->y[e] - e_size->h[e],
-			e_size->w[e],
-			e_size->h[e],
+			e_position->x[e] - w * 0.5f,
+			e_position->y[e] - h,
+			w,
+			h,
 		};
 		const SDL_FRect dstrect = {
 			origrect.x - camera.x,
@@ -68,27 +139,39 @@ void soa_draw_sprite(
 	}
 }
 
+/* One call for all the outlines, in the current draw color. */
 void soa_draw_rect(
 	const soa_position2 *e_position,
 	const soa_size2 *e_size,
 	const usize entity_count,
 	SDL_Renderer *renderer,
-	const f32v2 camera)
+	const f32v2 camera,
+	const f32v2 viewport)
 {
-	for (usize e = 0; e < entity_count; e++) {
+	soa_slot_t visible[entity_count];
+	usize visible_count;
+	soa_get_visible_slots(e_position, e_size, entity_count, camera, viewport, visible, &visible_count);
+
+	SDL_FRect rects[visible_count];
+	for (usize i = 0; i < visible_count; i++) {
+		const usize e = visible[i].idx;
+		const f32 w = soa_f16_to_f32(e_size->w[e]);
+		const f32 h = soa_f16_to_f32(e_size->h[e]);
 		const SDL_FRect origrect = {
-			e_position->x[e] - e_size->w[e] * 0.5f,
-			e_position->y[e] - e_size->h[e],
-			e_size->w[e],
-			e_size->h[e],
+			e_position->x[e] - w * 0.5f,
+			e_position->y[e] - h,
+			w,
+			h,
 		};
-		const SDL_FRect dstrect = {
+		rects[i] = (SDL_FRect){
 			origrect.x - camera.x,
 			origrect.y - camera.y,
 			origrect.w,
 			origrect.h,
 		};
-		SDL_RenderDrawRectF(renderer, &dstrect);
+	}
+	if (visible_count > 0) {
+		SDL_RenderDrawRectsF(renderer, rects, (int)visible_count);
 	}
 }
 
@@ -100,20 +183,28 @@ void soa_draw_sprite_rotated(
 	const usize entity_count,
 	SDL_Renderer *renderer,
 	SDL_Texture *texture,
-	const f32v2 camera)
+	const f32v2 camera,
+	const f32v2 viewport)
 {
-	for (usize e = 0; e < entity_count; e++) {
+	soa_slot_t visible[entity_count];
+	usize visible_count;
+	soa_get_visible_slots(e_position, e_size, entity_count, camera, viewport, visible, &visible_count);
+
+	for (usize i = 0; i < visible_count; i++) {
+		const usize e = visible[i].idx;
 		const SDL_Rect srcrect = {
 			e_clip->x[e],
 			e_clip->y[e],
 			e_clip->w[e],
 			e_clip->h[e],
 		};
+		const f32 w = soa_f16_to_f32(e_size->w[e]);
+		const f32 h = soa_f16_to_f32(e_size->h[e]);
 		const SDL_FRect origrect = {
-			e_position->x[e] - e_size->w[e] * 0.5f,
-			e_position->y[e] - e_size->h[e],
-			e_size->w[e],
-			e_size->h[e],
+			e_position->x[e] - w * 0.5f,
+			e_position->y[e] - h,
+			w,
+			h,
 		};
 		const SDL_FRect dstrect = {
 			origrect.x - camera.x,
@@ -121,32 +212,451 @@ void soa_draw_sprite_rotated(
 			origrect.w,
 			origrect.h,
 		};
-		const f32 angle = rad_to_deg(e_rotation->x[e]);
+		const f32 angle = rad_to_deg(soa_f16_to_f32(e_rotation->x[e]));
 		SDL_RenderCopyExF(renderer, texture, &srcrect, &dstrect, angle, NULL, SDL_FLIP_NONE);
 	}
 }
 
-void soa_draw_tilemap(
+/*
+ * Vertices follow the corner order of soa_get_quad_index, with the corners and
+ * texture coordinates SDL_RenderCopyF and SDL_RenderCopyExF use, so batched
+ * sprites rasterize like the ones copied one by one. Sprites without a rotation column
+ * keep their exact corners, rotated ones turn about their center. Sprites
+ * off the viewport and empty ones, like freed slots, are written but not
+ * counted, soa_get_visible_mask decides which. Returns the number
+ * of sprites kept, out_vertex needs room for all of them.
+ */
+static usize write_sprite_vertices(
+	const soa_position2 *e_position,
+	const soa_rotation1 *e_rotation,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const usize begin,
+	const usize count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const f32v2 texture_size,
+	SDL_Vertex *out_vertex)
+{
+	f32 width[count];
+	f32 height[count];
+	f32 sin[count];
+	f32 cos[count];
+	soa_f16_load(width, e_size->w + begin, count);
+	soa_f16_load(height, e_size->h + begin, count);
+	if (e_rotation != NULL) {
+		f32 rotation[count];
+		soa_f16_load(rotation, e_rotation->x + begin, count);
+		soa_f32_sincos(sin, cos, rotation, count);
+	}
+
+	u32 is_visible[count];
+	soa_get_visible_mask(e_position->x + begin, e_position->y + begin, width, height, count, camera, viewport,
+		is_visible);
+
+	const f32 inv_texture_w = 1.f / texture_size.x;
+	const f32 inv_texture_h = 1.f / texture_size.y;
+	const SDL_Color white = { 255, 255, 255, 255 };
+	usize sprite_count = 0;
+	for (usize i = 0; i < count; i++) {
+		const usize e = begin + i;
+		const f32 w = width[i];
+		const f32 h = height[i];
+		const f32 x = (e_position->x[e] - w * 0.5f) - camera.x;
+		const f32 y = (e_position->y[e] - h) - camera.y;
+		f32v2 p[4] = { { x, y }, { x, y + h }, { x + w, y }, { x + w, y + h } };
+		if (e_rotation != NULL) {
+			const f32 center_x = w * 0.5f + x;
+			const f32 center_y = h * 0.5f + y;
+			for (usize c = 0; c < 4; c++) {
+				const f32 dx = p[c].x - center_x;
+				const f32 dy = p[c].y - center_y;
+				p[c].x = (cos[i] * dx - sin[i] * dy) + center_x;
+				p[c].y = (sin[i] * dx + cos[i] * dy) + center_y;
+			}
+		}
+
+		const f32 min_u = (f32)e_clip->x[e] * inv_texture_w;
+		const f32 min_v = (f32)e_clip->y[e] * inv_texture_h;
+		const f32 max_u = (f32)(e_clip->x[e] + e_clip->w[e]) * inv_texture_w;
+		const f32 max_v = (f32)(e_clip->y[e] + e_clip->h[e]) * inv_texture_h;
+		SDL_Vertex *vertex = &out_vertex[sprite_count * 4];
+		vertex[0] = (SDL_Vertex){ { p[0].x, p[0].y }, white, { min_u, min_v } };
+		vertex[1] = (SDL_Vertex){ { p[1].x, p[1].y }, white, { min_u, max_v } };
+		vertex[2] = (SDL_Vertex){ { p[2].x, p[2].y }, white, { max_u, min_v } };
+		vertex[3] = (SDL_Vertex){ { p[3].x, p[3].y }, white, { max_u, max_v } };
+		sprite_count += is_visible[i] & 1u;
+	}
+	return sprite_count;
+}
+
+/*
+ * The batching primitive under the render queue: quads of one texture go out
+ * in a single SDL_RenderGeometry call on the shared quad index, however many
+ * entities they came from.
+ */
+void soa_draw_sprite_batch(
+	const SDL_Vertex *vertex,
+	const usize quad_count,
+	SDL_Renderer *renderer,
+	SDL_Texture *texture)
+{
+	if (quad_count == 0) {
+		return;
+	}
+	SDL_RenderGeometry(renderer, texture, vertex, (int)(quad_count * 4),
+		soa_get_quad_index(), (int)(quad_count * 6));
+}
+
+void soa_init_render_queue(
+	soa_render_queue *queue)
+{
+	queue->renderer = NULL;
+	queue->count = 0;
+	queue->quad_count = 0;
+	queue->state_count = 0;
+	queue->batch_count = 0;
+	queue->stats = (soa_render_stats){ 0 };
+}
+
+/* Starts the frame, the counters of the previous one are reset. */
+void soa_begin_render_queue(
+	soa_render_queue *queue,
+	SDL_Renderer *renderer)
+{
+	queue->renderer = renderer;
+	queue->count = 0;
+	queue->quad_count = 0;
+	queue->state_count = 0;
+	queue->batch_count = 0;
+	queue->stats = (soa_render_stats){ 0 };
+}
+
+/*
+ * Sorts the commands by key into sorted_vertex and merges the runs sharing a
+ * state into batches, counting what their submission will cost. Nothing is
+ * drawn, soa_submit_render_queue draws the batches.
+ */
+void soa_sort_render_queue(
+	soa_render_queue *queue)
+{
+	const usize count = queue->count;
+	queue->batch_count = 0;
+	if (count == 0) {
+		return;
+	}
+
+	u32 key[count], key_swap[count];
+	u32 command[count], command_swap[count];
+	for (usize c = 0; c < count; c++) {
+		key[c] = queue->key[c];
+		command[c] = (u32)c;
+	}
+	soa_u32_radix_sort(key, command, key_swap, command_swap, count);
+
+	SDL_Vertex *vertex = queue->sorted_vertex;
+	u32 sorted_first[count + 1];
+	usize v = 0;
+	for (usize c = 0; c < count; c++) {
+		const u32 from = command[c];
+		const usize vertex_count = (usize)queue->command_quads[from] * 4;
+		const SDL_Vertex *from_vertex = &queue->vertex[(usize)queue->first_quad[from] * 4];
+		sorted_first[c] = (u32)(v / 4);
+		for (usize i = 0; i < vertex_count; i++) {
+			vertex[v + i] = from_vertex[i];
+		}
+		v += vertex_count;
+	}
+	sorted_first[count] = (u32)(v / 4);
+
+	soa_render_stats *stats = &queue->stats;
+	const soa_render_state *previous = NULL;
+	usize batch_count = 0;
+	usize begin = 0;
+	while (begin < count) {
+		const u32 state_index = key[begin] & 0xffffffu;
+		usize end = begin + 1;
+		while (end < count && (key[end] & 0xffffffu) == state_index) {
+			end += 1;
+		}
+
+		const soa_render_state *state = &queue->state[state_index];
+		stats->texture_changes += previous == NULL || previous->texture != state->texture;
+		stats->blend_mode_changes += previous == NULL || previous->blend_mode != state->blend_mode;
+		queue->batch[batch_count++] = (soa_render_batch){
+			.state = state_index,
+			.first_quad = sorted_first[begin],
+			.quad_count = sorted_first[end] - sorted_first[begin],
+		};
+		previous = state;
+		begin = end;
+	}
+	queue->batch_count = batch_count;
+	stats->draw_count += (u32)batch_count;
+	stats->command_count += (u32)count;
+}
+
+/*
+ * Every batch is drawn with one sprite batch. Untextured commands blend with
+ * the draw blend mode of the renderer, which is restored afterwards, textured
+ * ones with the blend mode of their texture.
+ */
+void soa_submit_render_queue(
+	soa_render_queue *queue)
+{
+	soa_sort_render_queue(queue);
+
+	SDL_Renderer *renderer = queue->renderer;
+	if (queue->batch_count > 0) {
+		SDL_BlendMode previous_blend_mode;
+		SDL_GetRenderDrawBlendMode(renderer, &previous_blend_mode);
+		for (usize b = 0; b < queue->batch_count; b++) {
+			const soa_render_batch batch = queue->batch[b];
+			const soa_render_state *state = &queue->state[batch.state];
+			if (state->texture != NULL) {
+				SDL_SetTextureBlendMode(state->texture, state->blend_mode);
+			} else {
+				SDL_SetRenderDrawBlendMode(renderer, state->blend_mode);
+			}
+			soa_draw_sprite_batch(&queue->sorted_vertex[(usize)batch.first_quad * 4], batch.quad_count,
+				renderer, state->texture);
+		}
+		SDL_SetRenderDrawBlendMode(renderer, previous_blend_mode);
+	}
+
+	queue->count = 0;
+	queue->quad_count = 0;
+	queue->state_count = 0;
+	queue->batch_count = 0;
+}
+
+/*
+ * Key of the next commands. A queue without room for command_count more
+ * commands of quad_count quads in total, or without room for a new state, is
+ * submitted early, so layers are only ordered within each submission.
+ */
+static u32 render_queue_key(
+	soa_render_queue *queue,
+	const usize command_count,
+	const usize quad_count,
+	const u8 layer,
+	SDL_Texture *texture,
+	const SDL_BlendMode blend_mode)
+{
+	if (queue->count + command_count > SOA_RENDER_QUEUE_LIMIT ||
+		queue->quad_count + quad_count > SOA_RENDER_QUEUE_QUAD_LIMIT) {
+		soa_submit_render_queue(queue);
+	}
+	usize s = 0;
+	while (s < queue->state_count &&
+		(queue->state[s].texture != texture || queue->state[s].blend_mode != blend_mode)) {
+		s += 1;
+	}
+	if (s == SOA_RENDER_STATE_LIMIT) {
+		soa_submit_render_queue(queue);
+		s = 0;
+	}
+	if (s == queue->state_count) {
+		queue->state[s] = (soa_render_state){ texture, blend_mode };
+		queue->state_count += 1;
+	}
+	return (u32)layer << 24 | (u32)s;
+}
+
+static void queue_sprites(
+	const soa_position2 *e_position,
+	const soa_rotation1 *e_rotation,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	SDL_Texture *texture,
+	const SDL_BlendMode blend_mode,
+	const f32v2 texture_size,
+	soa_render_queue *queue)
+{
+	usize e = 0;
+	while (e < entity_count) {
+		const u32 key = render_queue_key(queue, 1, 1, layer, texture, blend_mode);
+		const usize first = queue->count;
+		const usize first_quad = queue->quad_count;
+		const usize command_space = SOA_RENDER_QUEUE_LIMIT - first;
+		const usize quad_space = SOA_RENDER_QUEUE_QUAD_LIMIT - first_quad;
+		const usize space = command_space < quad_space ? command_space : quad_space;
+		const usize count = entity_count - e < space ? entity_count - e : space;
+		const usize sprite_count = write_sprite_vertices(e_position, e_rotation, e_size, e_clip, e, count,
+			camera, viewport, texture_size, &queue->vertex[first_quad * 4]);
+		for (usize i = 0; i < sprite_count; i++) {
+			queue->key[first + i] = key;
+			queue->first_quad[first + i] = (u32)(first_quad + i);
+			queue->command_quads[first + i] = 1;
+		}
+		queue->count = first + sprite_count;
+		queue->quad_count = first_quad + sprite_count;
+		e += count;
+	}
+}
+
+void soa_queue_sprite(
+	const soa_position2 *e_position,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	SDL_Texture *texture,
+	const SDL_BlendMode blend_mode,
+	const f32v2 texture_size,
+	soa_render_queue *queue)
+{
+	queue_sprites(e_position, NULL, e_size, e_clip, entity_count, camera, viewport,
+		layer, texture, blend_mode, texture_size, queue);
+}
+
+void soa_queue_sprite_rotated(
+	const soa_position2 *e_position,
+	const soa_rotation1 *e_rotation,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	SDL_Texture *texture,
+	const SDL_BlendMode blend_mode,
+	const f32v2 texture_size,
+	soa_render_queue *queue)
+{
+	queue_sprites(e_position, e_rotation, e_size, e_clip, entity_count, camera, viewport,
+		layer, texture, blend_mode, texture_size, queue);
+}
+
+/* Appends a command of quad_count quads and returns its vertices to fill. */
+static SDL_Vertex *push_render_command(
+	soa_render_queue *queue,
+	const u32 key,
+	const usize quad_count)
+{
+	const usize c = queue->count;
+	const usize first_quad = queue->quad_count;
+	queue->key[c] = key;
+	queue->first_quad[c] = (u32)first_quad;
+	queue->command_quads[c] = (u32)quad_count;
+	queue->count = c + 1;
+	queue->quad_count = first_quad + quad_count;
+	return &queue->vertex[first_quad * 4];
+}
+
+/* Untextured quad from x1, y1 to x2, y2, wound like the sprites. */
+static void write_color_quad(
+	SDL_Vertex *vertex,
+	const f32 x1,
+	const f32 y1,
+	const f32 x2,
+	const f32 y2,
+	const SDL_Color color)
+{
+	vertex[0] = (SDL_Vertex){ { x1, y1 }, color, { 0.f, 0.f } };
+	vertex[1] = (SDL_Vertex){ { x1, y2 }, color, { 0.f, 0.f } };
+	vertex[2] = (SDL_Vertex){ { x2, y1 }, color, { 0.f, 0.f } };
+	vertex[3] = (SDL_Vertex){ { x2, y2 }, color, { 0.f, 0.f } };
+}
+
+void soa_queue_fill_rect(
+	const f32rect rect,
+	const u8v4 color,
+	const u8 layer,
+	const SDL_BlendMode blend_mode,
+	soa_render_queue *queue)
+{
+	const u32 key = render_queue_key(queue, 1, 1, layer, NULL, blend_mode);
+	const SDL_Color vertex_color = { color.r, color.g, color.b, color.a };
+	SDL_Vertex *vertex = push_render_command(queue, key, 1);
+	write_color_quad(vertex, rect.x, rect.y, rect.x + rect.w, rect.y + rect.h, vertex_color);
+}
+
+/*
+ * An outline is one command of four quads one pixel thick along the inside of
+ * the sprite bounds, the pixels SDL_RenderDrawRectF covers, without corners
+ * drawn twice. Every entity keeps its own color and they all share one state,
+ * so a layer of outlines is a single draw call.
+ */
+void soa_queue_rect(
+	const soa_position2 *e_position,
+	const soa_size2 *e_size,
+	const soa_color *e_color,
+	const usize entity_count,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	const SDL_BlendMode blend_mode,
+	soa_render_queue *queue)
+{
+	soa_slot_t visible[entity_count];
+	usize visible_count;
+	soa_get_visible_slots(e_position, e_size, entity_count, camera, viewport, visible, &visible_count);
+
+	for (usize i = 0; i < visible_count; i++) {
+		const usize e = visible[i].idx;
+		const f32 w = soa_f16_to_f32(e_size->w[e]);
+		const f32 h = soa_f16_to_f32(e_size->h[e]);
+		const f32 x1 = e_position->x[e] - w * 0.5f - camera.x;
+		const f32 y1 = e_position->y[e] - h - camera.y;
+		const f32 x2 = x1 + w;
+		const f32 y2 = y1 + h;
+		const SDL_Color color = { e_color->r[e], e_color->g[e], e_color->b[e], e_color->a[e] };
+		const u32 key = render_queue_key(queue, 1, 4, layer, NULL, blend_mode);
+		SDL_Vertex *vertex = push_render_command(queue, key, 4);
+		write_color_quad(&vertex[0], x1, y1, x2, y1 + 1.f, color);
+		write_color_quad(&vertex[4], x1, y2 - 1.f, x2, y2, color);
+		write_color_quad(&vertex[8], x1, y1 + 1.f, x1 + 1.f, y2 - 1.f, color);
+		write_color_quad(&vertex[12], x2 - 1.f, y1 + 1.f, x2, y2 - 1.f, color);
+	}
+}
+
+/* Tiles from x1, y1 up to but not including x2, y2 that touch the viewport. */
+static u32v4 tile_range_in_viewport(
+	const tilemap_t *tilemap,
+	const i32v2 tile_size,
+	const f32v2 camera,
+	const f32v2 viewport)
+{
+	const f32 x0 = floorf(camera.x / (f32)tile_size.width);
+	const f32 y0 = floorf(camera.y / (f32)tile_size.height);
+	const f32 x1 = floorf((camera.x + viewport.x) / (f32)tile_size.width) + 1.f;
+	const f32 y1 = floorf((camera.y + viewport.y) / (f32)tile_size.height) + 1.f;
+	const f32 w = (f32)tilemap->width;
+	const f32 h = (f32)tilemap->height;
+	return (u32v4){
+		.x1 = (u32)(x0 < 0.f ? 0.f : x0 > w ? w : x0),
+		.y1 = (u32)(y0 < 0.f ? 0.f : y0 > h ? h : y0),
+		.x2 = (u32)(x1 < 0.f ? 0.f : x1 > w ? w : x1),
+		.y2 = (u32)(y1 < 0.f ? 0.f : y1 > h ? h : y1),
+	};
+}
+
+/* Tiles of the range end up at their map position plus offset, in whole pixels. */
+static void draw_tile_range(
 	const tilemap_t *tilemap,
 	const tilemap_encoding_t *tilemap_encoding,
 	const tileset_t *tileset,
 	const i32v2 tile_size,
+	const u32v4 range,
+	const i32v2 offset,
 	SDL_Renderer *renderer,
-	SDL_Texture *tilesheet_texture,
-	const f32v2 camera)
+	SDL_Texture *tilesheet_texture)
 {
 	const u32 mapwidth = tilemap->width;
-	const u32 mapheight = tilemap->height;
-	const u32 tilewidth = tile_size.width;
-	const u32 tileheight = tile_size.height;
-
 	for (usize l = 0; l < tilemap->num_layers; l++) {
 		const tilemap_layer_t *layer = &tilemap->layers[l];
 
-		for (usize y = 0; y < mapheight; y++) {
-			for (usize x = 0; x < mapwidth; x++) {
-				const usize offset = y * mapwidth + x;
-				const u8 tile_char = layer->offset_to_char[offset];
+		for (usize y = range.y1; y < range.y2; y++) {
+			for (usize x = range.x1; x < range.x2; x++) {
+				const usize offset_in_map = y * mapwidth + x;
+				const u8 tile_char = layer->offset_to_char[offset_in_map];
 				const tile_enum_t tile_enum = tilemap_encoding->char_to_enum[tile_char];
 				if (tile_enum < TILEMAP_TILE_BEGIN || tile_enum > TILEMAP_TILE_END) continue;
 				const tile_t tile = tileset->enum_to_tile[tile_enum];
@@ -157,17 +667,11 @@ void soa_draw_tilemap(
 					tile.w,
 					tile.h,
 				};
-				const SDL_Rect origrect = {
-					x * tilewidth,
-					y * tileheight,
-					tilewidth,
-					tileheight,
-				};
 				const SDL_Rect dstrect = {
-					origrect.x - (i32)camera.x,
-					origrect.y - (i32)camera.y,
-					origrect.w,
-					origrect.h,
+					(i32)x * tile_size.width + offset.x,
+					(i32)y * tile_size.height + offset.y,
+					tile_size.width,
+					tile_size.height,
 				};
 				SDL_RenderCopy(renderer, tilesheet_texture, &srcrect, &dstrect);
 			}
@@ -175,29 +679,217 @@ void soa_draw_tilemap(
 	}
 }
 
-void soa_draw_tilemap_collision_buffer(
+void soa_draw_tilemap(
 	const tilemap_t *tilemap,
+	const tilemap_encoding_t *tilemap_encoding,
+	const tileset_t *tileset,
 	const i32v2 tile_size,
 	SDL_Renderer *renderer,
-	const f32v2 camera)
+	SDL_Texture *tilesheet_texture,
+	const f32v2 camera,
+	const f32v2 viewport)
 {
-	const u32 mapwidth = tilemap->width;
-	const u32 mapheight = tilemap->height;
+	const u32v4 range = tile_range_in_viewport(tilemap, tile_size, camera, viewport);
+	const i32v2 offset = { -(i32)camera.x, -(i32)camera.y };
+	draw_tile_range(tilemap, tilemap_encoding, tileset, tile_size, range, offset, renderer, tilesheet_texture);
+}
+
+/* Tiles of one chunk, clipped to the map. */
+static u32v4 chunk_tile_range(
+	const soa_tilemap_chunks *chunks,
+	const tilemap_t *tilemap,
+	const u32 cx,
+	const u32 cy)
+{
+	const u32 chunk_tiles = chunks->chunk_tiles;
+	const u32 x0 = cx * chunk_tiles;
+	const u32 y0 = cy * chunk_tiles;
+	return (u32v4){
+		.x1 = x0,
+		.y1 = y0,
+		.x2 = x0 + chunk_tiles < tilemap->width ? x0 + chunk_tiles : tilemap->width,
+		.y2 = y0 + chunk_tiles < tilemap->height ? y0 + chunk_tiles : tilemap->height,
+	};
+}
+
+/*
+ * Chunks start at 16 x 16 tiles and grow until the map fits the chunk limit.
+ * The textures are transparent where no layer has a tile. A chunk whose
+ * render target cannot be created or bound keeps a NULL texture and is drawn
+ * tile by tile instead.
+ */
+void soa_init_tilemap_chunks(
+	soa_tilemap_chunks *chunks,
+	const tilemap_t *tilemap,
+	const i32v2 tile_size,
+	SDL_Renderer *renderer)
+{
+	u32 chunk_tiles = 16;
+	u32 width, height;
+	for (;;) {
+		width = (tilemap->width + chunk_tiles - 1) / chunk_tiles;
+		height = (tilemap->height + chunk_tiles - 1) / chunk_tiles;
+		if (width * height <= SOA_TILEMAP_CHUNK_LIMIT) break;
+		chunk_tiles *= 2;
+	}
 
-	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	chunks->chunk_tiles = chunk_tiles;
+	chunks->width = width;
+	chunks->height = height;
+	chunks->tile_size = tile_size;
+	for (usize c = 0; c < (usize)width * height; c++) {
+		SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+			(i32)chunk_tiles * tile_size.width, (i32)chunk_tiles * tile_size.height);
+		if (texture == NULL) {
+			SDL_Log("tilemap chunk %zu falls back to tiles: %s", (size_t)c, SDL_GetError());
+		} else {
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		}
+		chunks->texture[c] = texture;
+		chunks->is_dirty[c] = true;
+	}
+}
+
+void soa_fini_tilemap_chunks(
+	soa_tilemap_chunks *chunks)
+{
+	for (usize c = 0; c < (usize)chunks->width * chunks->height; c++) {
+		SDL_DestroyTexture(chunks->texture[c]);
+		chunks->texture[c] = NULL;
+	}
+	chunks->width = 0;
+	chunks->height = 0;
+}
+
+/* Marks the chunk of a tile that changed. */
+void soa_invalidate_tilemap_chunk(
+	soa_tilemap_chunks *chunks,
+	const i32v2 tile_position)
+{
+	const u32 x = (u32)tile_position.x / chunks->chunk_tiles;
+	const u32 y = (u32)tile_position.y / chunks->chunk_tiles;
+	if (tile_position.x < 0 || tile_position.y < 0 || x >= chunks->width || y >= chunks->height) return;
+	chunks->is_dirty[y * chunks->width + x] = true;
+}
+
+/* Render targets lose their content when the device resets. */
+void soa_invalidate_tilemap_chunks(
+	soa_tilemap_chunks *chunks)
+{
+	for (usize c = 0; c < (usize)chunks->width * chunks->height; c++) {
+		chunks->is_dirty[c] = true;
+	}
+}
+
+void soa_bake_tilemap_chunks(
+	soa_tilemap_chunks *chunks,
+	const tilemap_t *tilemap,
+	const tilemap_encoding_t *tilemap_encoding,
+	const tileset_t *tileset,
+	SDL_Renderer *renderer,
+	SDL_Texture *tilesheet_texture)
+{
+	const i32v2 tile_size = chunks->tile_size;
+	SDL_Texture *previous_target = SDL_GetRenderTarget(renderer);
+	SDL_Color previous_color;
+	SDL_GetRenderDrawColor(renderer, &previous_color.r, &previous_color.g, &previous_color.b, &previous_color.a);
+	bool has_baked = false;
+
+	for (u32 cy = 0; cy < chunks->height; cy++) {
+		for (u32 cx = 0; cx < chunks->width; cx++) {
+			const usize c = (usize)cy * chunks->width + cx;
+			if (!chunks->is_dirty[c] || chunks->texture[c] == NULL) continue;
+			has_baked = true;
+
+			if (SDL_SetRenderTarget(renderer, chunks->texture[c]) != 0) {
+				SDL_Log("tilemap chunk %zu falls back to tiles: %s", (size_t)c, SDL_GetError());
+				SDL_DestroyTexture(chunks->texture[c]);
+				chunks->texture[c] = NULL;
+				continue;
+			}
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+			SDL_RenderClear(renderer);
+
+			const u32v4 range = chunk_tile_range(chunks, tilemap, cx, cy);
+			const i32v2 offset = { -(i32)range.x1 * tile_size.width, -(i32)range.y1 * tile_size.height };
+			draw_tile_range(tilemap, tilemap_encoding, tileset, tile_size, range, offset,
+				renderer, tilesheet_texture);
+			chunks->is_dirty[c] = false;
+		}
+	}
+
+	if (has_baked) {
+		SDL_SetRenderTarget(renderer, previous_target);
+		SDL_SetRenderDrawColor(renderer, previous_color.r, previous_color.g, previous_color.b, previous_color.a);
+	}
+}
+
+/*
+ * Chunks are placed on whole pixels, like the tiles of soa_draw_tilemap.
+ * Chunks without a texture draw their tiles directly.
+ */
+void soa_draw_tilemap_chunks(
+	const soa_tilemap_chunks *chunks,
+	const tilemap_t *tilemap,
+	const tilemap_encoding_t *tilemap_encoding,
+	const tileset_t *tileset,
+	SDL_Renderer *renderer,
+	SDL_Texture *tilesheet_texture,
+	const f32v2 camera,
+	const f32v2 viewport)
+{
+	const i32 chunk_w = (i32)chunks->chunk_tiles * chunks->tile_size.width;
+	const i32 chunk_h = (i32)chunks->chunk_tiles * chunks->tile_size.height;
+	const i32 camera_x = (i32)camera.x;
+	const i32 camera_y = (i32)camera.y;
+
+	for (u32 cy = 0; cy < chunks->height; cy++) {
+		for (u32 cx = 0; cx < chunks->width; cx++) {
+			const SDL_Rect dstrect = {
+				(i32)cx * chunk_w - camera_x,
+				(i32)cy * chunk_h - camera_y,
+				chunk_w,
+				chunk_h,
+			};
+			const bool is_visible = dstrect.x < (i32)viewport.x && dstrect.x + chunk_w > 0 &&
+						dstrect.y < (i32)viewport.y && dstrect.y + chunk_h > 0;
+			if (!is_visible) continue;
+			SDL_Texture *texture = chunks->texture[(usize)cy * chunks->width + cx];
+			if (texture == NULL) {
+				const i32v2 offset = { -camera_x, -camera_y };
+				draw_tile_range(tilemap, tilemap_encoding, tileset, chunks->tile_size,
+					chunk_tile_range(chunks, tilemap, cx, cy), offset, renderer, tilesheet_texture);
+				continue;
+			}
+			SDL_RenderCopy(renderer, texture, NULL, &dstrect);
+		}
+	}
+}
+
+/* The tiles only differ by color, so they all end up in one draw call. */
+void soa_queue_tilemap_collision_buffer(
+	const tilemap_t *tilemap,
+	const i32v2 tile_size,
+	const f32v2 camera,
+	const f32v2 viewport,
+	const u8 layer,
+	soa_render_queue *queue)
+{
+	const u32 mapwidth = tilemap->width;
+	const u32v4 range = tile_range_in_viewport(tilemap, tile_size, camera, viewport);
 
-	for (usize y = 0; y < mapheight; y++) {
-		for (usize x = 0; x < mapwidth; x++) {
+	for (usize y = range.y1; y < range.y2; y++) {
+		for (usize x = range.x1; x < range.x2; x++) {
 			const usize offset = y * mapwidth + x;
 			const f32 tile_speed = tilemap->collision_buffer.offset_to_walking_speed[offset];
-			const SDL_Rect rect = {
-				x * tile_size.width - (i32)camera.x,
-				y * tile_size.height - (i32)camera.y,
-				tile_size.width,
-				tile_size.height,
+			const f32rect rect = {
+				(f32)((i32)x * tile_size.width - (i32)camera.x),
+				(f32)((i32)y * tile_size.height - (i32)camera.y),
+				(f32)tile_size.width,
+				(f32)tile_size.height,
 			};
-			SDL_SetRenderDrawColor(renderer, 255, 0, 0, (Uint8)(100.f * (1.f - tile_speed)));
-			SDL_RenderFillRect(renderer, &rect);
+			const u8v4 color = { 255, 0, 0, (u8)(100.f * (1.f - tile_speed)) };
+			soa_queue_fill_rect(rect, color, layer, SDL_BLENDMODE_BLEND, queue);
 		}
 	}
 }
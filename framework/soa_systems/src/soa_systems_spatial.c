@@ -0,0 +1,301 @@
+#include <math.h>
+#include <soa.h>
+#include <soa_components_spatial.h>
+#include <soa_components_transform.h>
+#include <soa_systems_spatial.h>
+
+static i32 spatial_grid_cell_coord(
+	const f32 position,
+	const f32 origin,
+	const f32 cell_size)
+{
+	/* Clamp so that points very far from the grid do not overflow the cast. */
+	const f32 cell = floorf((position - origin) / cell_size);
+	const f32 limit = (f32)(1 << 24);
+	return (i32)(cell < -limit ? -limit : cell > limit ? limit : cell);
+}
+
+static i32 spatial_grid_clamped_cell(
+	const f32 position,
+	const f32 origin,
+	const f32 cell_size,
+	const u32 cell_count)
+{
+	const i32 cell = spatial_grid_cell_coord(position, origin, cell_size);
+	const i32 last = (i32)cell_count - 1;
+	return cell < 0 ? 0 : cell > last ? last : cell;
+}
+
+static i32 i32_abs(
+	const i32 a)
+{
+	return a < 0 ? -a : a;
+}
+
+static i32 i32_max(
+	const i32 a,
+	const i32 b)
+{
+	return a > b ? a : b;
+}
+
+static void spatial_grid_nearest_in_cell(
+	const soa_spatial_grid *grid,
+	const usize cell,
+	const f32v2 point,
+	f32 *best_distance2,
+	u32 *best_index)
+{
+	const u32 begin = grid->cell_start[cell];
+	const u32 end = grid->cell_start[cell + 1];
+	for (u32 i = begin; i < end; i++) {
+		const f32 dx = grid->x[i] - point.x;
+		const f32 dy = grid->y[i] - point.y;
+		const f32 distance2 = dx * dx + dy * dy;
+		const bool is_closer = distance2 < *best_distance2;
+		*best_distance2 = is_closer ? distance2 : *best_distance2;
+		*best_index = is_closer ? i : *best_index;
+	}
+}
+
+static i32 i32_min(
+	const i32 a,
+	const i32 b)
+{
+	return a < b ? a : b;
+}
+
+/*
+ * Search rings of cells around the cell of the point, from the inside out.
+ * Every cell on ring k is at least (k - 1) cells away from the point, so the
+ * search stops as soon as that lower bound exceeds the best distance found.
+ * Rings closer than the grid bounds are empty, the search starts at the
+ * first ring that touches the grid and only walks the cells inside it.
+ */
+static bool spatial_grid_nearest(
+	const soa_spatial_grid *grid,
+	const f32v2 point,
+	soa_slot_t *out_nearest)
+{
+	if (grid->count == 0) {
+		return false;
+	}
+
+	const i32 w = (i32)grid->width;
+	const i32 h = (i32)grid->height;
+	const f32 cell_size = grid->cell_size;
+	const i32 cx = spatial_grid_cell_coord(point.x, grid->origin.x, cell_size);
+	const i32 cy = spatial_grid_cell_coord(point.y, grid->origin.y, cell_size);
+	const i32 min_ring = i32_max(
+		i32_max(i32_max(-cx, cx - (w - 1)), i32_max(-cy, cy - (h - 1))), 0);
+	const i32 max_ring = i32_max(
+		i32_max(i32_abs(cx), i32_abs(w - 1 - cx)),
+		i32_max(i32_abs(cy), i32_abs(h - 1 - cy)));
+
+	f32 best_distance2 = INFINITY;
+	u32 best_index = 0;
+
+	for (i32 k = min_ring; k <= max_ring; k++) {
+		const f32 lower_bound = (f32)(k - 1) * cell_size;
+		if (k > min_ring && lower_bound * lower_bound > best_distance2) {
+			break;
+		}
+		const i32 x0 = i32_max(cx - k, 0);
+		const i32 x1 = i32_min(cx + k, w - 1);
+		const i32 y0 = i32_max(cy - k, 0);
+		const i32 y1 = i32_min(cy + k, h - 1);
+		for (i32 y = y0; y <= y1; y++) {
+			const usize row = (usize)y * (usize)w;
+			const bool is_full_row = y == cy - k || y == cy + k;
+			if (is_full_row) {
+				for (i32 x = x0; x <= x1; x++) {
+					spatial_grid_nearest_in_cell(grid, row + (usize)x, point, &best_distance2, &best_index);
+				}
+				continue;
+			}
+			if (cx - k >= 0) {
+				spatial_grid_nearest_in_cell(grid, row + (usize)(cx - k), point, &best_distance2, &best_index);
+			}
+			if (k > 0 && cx + k < w) {
+				spatial_grid_nearest_in_cell(grid, row + (usize)(cx + k), point, &best_distance2, &best_index);
+			}
+		}
+	}
+
+	*out_nearest = grid->slot[best_index];
+	return best_distance2 != INFINITY;
+}
+
+void soa_build_spatial_grid(
+	const soa_position2 *e_position,
+	const soa_entity_t *entity,
+	const f32 cell_size,
+	soa_spatial_grid *out_grid)
+{
+	const usize entity_count = entity->count;
+
+	f32v2 min = { INFINITY, INFINITY };
+	f32v2 max = { -INFINITY, -INFINITY };
+	u32 count = 0;
+	for (usize e = 0; e < entity_count; e++) {
+		if (!entity->is_occupied[e]) continue;
+		const f32 x = e_position->x[e];
+		const f32 y = e_position->y[e];
+		min.x = x < min.x ? x : min.x;
+		min.y = y < min.y ? y : min.y;
+		max.x = x > max.x ? x : max.x;
+		max.y = y > max.y ? y : max.y;
+		count += 1;
+	}
+
+	out_grid->count = count;
+	if (count == 0) {
+		out_grid->origin = (f32v2){ 0.f, 0.f };
+		out_grid->cell_size = cell_size;
+		out_grid->width = 0;
+		out_grid->height = 0;
+		out_grid->cell_start[0] = 0;
+		return;
+	}
+
+	/* Sparse sets get cells of about two entities each, then the cells grow
+	 * until the bounds fit within the cell limit. */
+	const f32 area = (max.x - min.x) * (max.y - min.y);
+	const f32 density_size = sqrtf(area * 2.f / (f32)count);
+	f32 size = density_size > cell_size ? density_size : cell_size;
+	u32 width, height;
+	for (;;) {
+		width = (u32)((max.x - min.x) / size) + 1;
+		height = (u32)((max.y - min.y) / size) + 1;
+		if ((u64)width * height <= SOA_SPATIAL_GRID_CELL_LIMIT) break;
+		size *= 2.f;
+	}
+	const u32 cell_count = width * height;
+
+	out_grid->origin = min;
+	out_grid->cell_size = size;
+	out_grid->width = width;
+	out_grid->height = height;
+
+	/* Counting sort of the occupied slots by cell. */
+	u32 *cell_start = out_grid->cell_start;
+	for (u32 c = 0; c <= cell_count; c++) {
+		cell_start[c] = 0;
+	}
+
+	u32 entity_cell[entity_count];
+	for (usize e = 0; e < entity_count; e++) {
+		if (!entity->is_occupied[e]) continue;
+		const u32 x = (u32)((e_position->x[e] - min.x) / size);
+		const u32 y = (u32)((e_position->y[e] - min.y) / size);
+		const u32 cell = (y < height ? y : height - 1) * width + (x < width ? x : width - 1);
+		entity_cell[e] = cell;
+		cell_start[cell + 1] += 1;
+	}
+
+	for (u32 c = 0; c < cell_count; c++) {
+		cell_start[c + 1] += cell_start[c];
+	}
+
+	u32 cell_cursor[cell_count];
+	for (u32 c = 0; c < cell_count; c++) {
+		cell_cursor[c] = cell_start[c];
+	}
+
+	for (usize e = 0; e < entity_count; e++) {
+		if (!entity->is_occupied[e]) continue;
+		const u32 i = cell_cursor[entity_cell[e]]++;
+		out_grid->slot[i] = (soa_slot_t){ e };
+		out_grid->x[i] = e_position->x[e];
+		out_grid->y[i] = e_position->y[e];
+	}
+}
+
+void soa_find_nearest_in_spatial_grid(
+	const soa_position2 *q_position,
+	const usize query_count,
+	const soa_spatial_grid *grid,
+	soa_slot_t *out_nearest,
+	u8bool *out_found)
+{
+#pragma omp parallel for if (query_count > 256) schedule(static, 256)
+	for (usize q = 0; q < query_count; q++) {
+		const f32v2 point = { q_position->x[q], q_position->y[q] };
+		soa_slot_t nearest = { 0 };
+		out_found[q] = spatial_grid_nearest(grid, point, &nearest);
+		out_nearest[q] = nearest;
+	}
+}
+
+/*
+ * Results are appended as (query, found, distance) triples. A query whose
+ * results do not fit anymore is rolled back and the search stops there, so
+ * the caller can continue from out_query_count. Capacity has to be at least
+ * the grid count for a single query to always fit.
+ */
+void soa_find_in_radius_in_spatial_grid(
+	const soa_position2 *q_position,
+	const soa_slot_t *q_slots,
+	const usize query_count,
+	const f32 radius,
+	const soa_spatial_grid *grid,
+	const usize out_capacity,
+	soa_slot_t *out_query_slots,
+	soa_slot_t *out_found_slots,
+	f32 *out_distance,
+	usize *out_count,
+	usize *out_query_count)
+{
+	if (grid->count == 0) {
+		*out_count = 0;
+		*out_query_count = query_count;
+		return;
+	}
+
+	const f32 radius2 = radius * radius;
+	usize count = 0;
+	usize q = 0;
+
+	for (; q < query_count; q++) {
+		const soa_slot_t query = q_slots[q];
+		const f32 x = q_position->x[query.idx];
+		const f32 y = q_position->y[query.idx];
+		const i32 x0 = spatial_grid_clamped_cell(x - radius, grid->origin.x, grid->cell_size, grid->width);
+		const i32 x1 = spatial_grid_clamped_cell(x + radius, grid->origin.x, grid->cell_size, grid->width);
+		const i32 y0 = spatial_grid_clamped_cell(y - radius, grid->origin.y, grid->cell_size, grid->height);
+		const i32 y1 = spatial_grid_clamped_cell(y + radius, grid->origin.y, grid->cell_size, grid->height);
+
+		const usize query_begin = count;
+		bool is_full = false;
+		for (i32 cy = y0; cy <= y1; cy++) {
+			/* Cells of a row are contiguous, walk them as one range. */
+			const usize row = (usize)cy * grid->width;
+			const u32 begin = grid->cell_start[row + (usize)x0];
+			const u32 end = grid->cell_start[row + (usize)x1 + 1];
+			is_full = count + (end - begin) > out_capacity;
+			if (is_full) break;
+			for (u32 i = begin; i < end; i++) {
+				const f32 dx = grid->x[i] - x;
+				const f32 dy = grid->y[i] - y;
+				const f32 distance2 = dx * dx + dy * dy;
+				out_query_slots[count] = query;
+				out_found_slots[count] = grid->slot[i];
+				out_distance[count] = distance2;
+				count += distance2 <= radius2;
+			}
+		}
+
+		if (is_full) {
+			count = query_begin;
+			break;
+		}
+	}
+
+	/* Only the hits pay for a square root. */
+	for (usize i = 0; i < count; i++) {
+		out_distance[i] = sqrtf(out_distance[i]);
+	}
+
+	*out_count = count;
+	*out_query_count = q;
+}
@@ -1,4 +1,9 @@
+#include <math.h>
+#include <math/soa_fixed.h>
+#include <soa.h>
+#include <soa_components_movement.h>
 #include <soa_components_physics.h>
+#include <soa_components_tilemap.h>
 #include <soa_components_transform.h>
 #include <soa_systems_tilemap.h>
 #include <tilemap.h>
@@ -50,6 +55,22 @@ void soa_multiply_velocity_by_future_tile_speed(
 {
 	const u32 mapwidth = tilemap->width;
 	const usize e = entity_slot.idx;
+#ifdef SOA_DETERMINISTIC
+	/* Q16.16 like soa_move, integer division truncates like the cast below. */
+	const f32 state[5] = { e_position->x[e], e_position->y[e], e_velocity->x[e], e_velocity->y[e], dt.seconds };
+	q16 fixed[5];
+	soa_q16_from_f32(fixed, state, 5);
+	const q16 future_x = fixed[0] + soa_q16_mul1(fixed[2], fixed[4]);
+	const q16 future_y = fixed[1] + soa_q16_mul1(fixed[3], fixed[4]);
+	const i32 tile_x = future_x / SOA_Q16_ONE / tile_size.width;
+	const i32 tile_y = future_y / SOA_Q16_ONE / tile_size.height;
+	const usize offset = tile_y * mapwidth + tile_x;
+	q16 tile_speed;
+	soa_q16_from_f32(&tile_speed, &tilemap->collision_buffer.offset_to_walking_speed[offset], 1);
+	const q16 velocity[2] = { soa_q16_mul1(fixed[2], tile_speed), soa_q16_mul1(fixed[3], tile_speed) };
+	soa_f32_from_q16(&e_velocity->x[e], &velocity[0], 1);
+	soa_f32_from_q16(&e_velocity->y[e], &velocity[1], 1);
+#else
 	const f32 future_x = e_position->x[e] + e_velocity->x[e] * dt.seconds;
 	const f32 future_y = e_position->y[e] + e_velocity->y[e] * dt.seconds;
 	const i32 tile_x = (i32)future_x / tile_size.width;
@@ -58,4 +79,104 @@ void soa_multiply_velocity_by_future_tile_speed(
 	const f32 tile_speed = tilemap->collision_buffer.offset_to_walking_speed[offset];
 	e_velocity->x[e] *= tile_speed;
 	e_velocity->y[e] *= tile_speed;
+#endif
+}
+
+enum {
+	RAYCAST_CHUNK = 256,
+};
+
+/*
+ * Amanatides-Woo grid traversal over the collision buffer. A tile blocks a
+ * ray when its walking speed is 0, tiles outside of the map block as well.
+ * Rays are traced in chunks, one chunk per worker. The setup of a chunk is
+ * branch-free over SoA arrays and vectorizes across rays. The walk itself
+ * stays one ray at a time: lockstep lanes measured slower than this since
+ * every step is a gather and rays of a packet diverge in length.
+ */
+void soa_raycast_tilemap(
+	const soa_position2 *r_origin,
+	const soa_movement2 *r_direction,
+	const usize ray_count,
+	const f32 max_distance,
+	const tilemap_t *tilemap,
+	const i32v2 tile_size,
+	soa_raycast_hit *out_hit)
+{
+	const i32 mapwidth = (i32)tilemap->width;
+	const i32 mapheight = (i32)tilemap->height;
+	const f32 tilewidth = (f32)tile_size.width;
+	const f32 tileheight = (f32)tile_size.height;
+	const f32 *walking_speed = tilemap->collision_buffer.offset_to_walking_speed;
+	const usize chunk_count = soa_round_up(ray_count, RAYCAST_CHUNK) / RAYCAST_CHUNK;
+
+#pragma omp parallel for if (ray_count > RAYCAST_CHUNK) schedule(static, 1)
+	for (usize c = 0; c < chunk_count; c++) {
+		const usize first = c * RAYCAST_CHUNK;
+		const usize count = first + RAYCAST_CHUNK < ray_count ? RAYCAST_CHUNK : ray_count - first;
+		f32 t_max_x[RAYCAST_CHUNK];
+		f32 t_max_y[RAYCAST_CHUNK];
+		f32 t_delta_x[RAYCAST_CHUNK];
+		f32 t_delta_y[RAYCAST_CHUNK];
+		i32 tile_x[RAYCAST_CHUNK];
+		i32 tile_y[RAYCAST_CHUNK];
+		i32 step_x[RAYCAST_CHUNK];
+		i32 step_y[RAYCAST_CHUNK];
+
+#pragma omp simd
+		for (usize i = 0; i < count; i++) {
+			const f32 x = r_origin->x[first + i];
+			const f32 y = r_origin->y[first + i];
+			const f32 dx = r_direction->x[first + i];
+			const f32 dy = r_direction->y[first + i];
+			const f32 length2 = dx * dx + dy * dy;
+			const f32 inv_length = length2 != 0.f ? 1.f / sqrtf(length2) : 0.f;
+			const f32 dir_x = dx * inv_length;
+			const f32 dir_y = dy * inv_length;
+			const f32 fx = x / tilewidth;
+			const f32 fy = y / tileheight;
+			const i32 cell_x = (i32)fx - (fx < (f32)(i32)fx);
+			const i32 cell_y = (i32)fy - (fy < (f32)(i32)fy);
+			const f32 border_x = (f32)(cell_x + (dir_x > 0.f)) * tilewidth;
+			const f32 border_y = (f32)(cell_y + (dir_y > 0.f)) * tileheight;
+			tile_x[i] = cell_x;
+			tile_y[i] = cell_y;
+			step_x[i] = dir_x > 0.f ? 1 : -1;
+			step_y[i] = dir_y > 0.f ? 1 : -1;
+			t_max_x[i] = dir_x != 0.f ? (border_x - x) / dir_x : INFINITY;
+			t_max_y[i] = dir_y != 0.f ? (border_y - y) / dir_y : INFINITY;
+			t_delta_x[i] = dir_x != 0.f ? tilewidth / fabsf(dir_x) : INFINITY;
+			t_delta_y[i] = dir_y != 0.f ? tileheight / fabsf(dir_y) : INFINITY;
+		}
+
+		for (usize i = 0; i < count; i++) {
+			i32 x = tile_x[i];
+			i32 y = tile_y[i];
+			f32 t = 0.f;
+			f32 next_x = t_max_x[i];
+			f32 next_y = t_max_y[i];
+			bool is_hit = false;
+			while (t <= max_distance) {
+				const bool is_inside = x >= 0 && x < mapwidth && y >= 0 && y < mapheight;
+				if (!is_inside || walking_speed[y * mapwidth + x] <= 0.f) {
+					is_hit = true;
+					break;
+				}
+				if (next_x < next_y) {
+					t = next_x;
+					next_x += t_delta_x[i];
+					x += step_x[i];
+				} else {
+					t = next_y;
+					next_y += t_delta_y[i];
+					y += step_y[i];
+				}
+			}
+			const usize r = first + i;
+			out_hit->distance[r] = is_hit ? t : max_distance;
+			out_hit->tile_x[r] = x;
+			out_hit->tile_y[r] = y;
+			out_hit->is_hit[r] = is_hit;
+		}
+	}
 }
@@ -1,3 +1,4 @@
+#include <math/soa_math.h>
 #include <soa.h>
 #include <soa_components_transform.h>
 #include <soa_systems_transform.h>
@@ -33,3 +34,82 @@ void soa_backup_position2(
 		e_old_position->y[e] = e_position->y[e];
 	}
 }
+
+/* Blends the last two simulated positions for rendering between steps. */
+void soa_interpolate_position2(
+	const soa_position2 *e_old_position,
+	const soa_position2 *e_position,
+	const usize entity_count,
+	const f32 alpha,
+	soa_position2 *out_position)
+{
+	soa_f32_lerp(out_position->x, e_old_position->x, e_position->x, alpha, entity_count);
+	soa_f32_lerp(out_position->y, e_old_position->y, e_position->y, alpha, entity_count);
+}
+
+lwc32v2 soa_get_one_lwc_position2(
+	const soa_lwc_position2 *e_position,
+	const soa_slot_t entity_slot)
+{
+	const usize e = entity_slot.idx;
+	return (lwc32v2) {
+		.x = { e_position->tile_x[e], e_position->x[e] },
+		.y = { e_position->tile_y[e], e_position->y[e] },
+	};
+}
+
+void soa_change_one_lwc_position2(
+	soa_lwc_position2 *e_position,
+	const soa_slot_t entity_slot,
+	const lwc32v2 new_position)
+{
+	const usize e = entity_slot.idx;
+	e_position->tile_x[e] = new_position.x.tile;
+	e_position->tile_y[e] = new_position.y.tile;
+	e_position->x[e] = new_position.x.local;
+	e_position->y[e] = new_position.y.local;
+}
+
+void soa_backup_lwc_position2(
+	const soa_lwc_position2 *e_position,
+	soa_lwc_position2 *e_old_position,
+	const usize entity_count)
+{
+	for (usize e = 0; e < entity_count; e++) {
+		e_old_position->tile_x[e] = e_position->tile_x[e];
+		e_old_position->tile_y[e] = e_position->tile_y[e];
+		e_old_position->x[e] = e_position->x[e];
+		e_old_position->y[e] = e_position->y[e];
+	}
+}
+
+/*
+ * Moves whole tiles out of the offsets so they go back to [0, tile_size).
+ * Floor is done with a truncating cast and a compare so the loop vectorizes
+ * without SSE4.1.
+ */
+void soa_renormalize_lwc_position2(
+	soa_lwc_position2 *e_position,
+	const usize entity_count,
+	const f32 tile_size)
+{
+	const f32 inv_tile_size = 1.f / tile_size;
+	for (usize e = 0; e < entity_count; e++) {
+		const f32 tiles_x = e_position->x[e] * inv_tile_size;
+		const f32 tiles_y = e_position->y[e] * inv_tile_size;
+		i32 shift_x = (i32)tiles_x;
+		i32 shift_y = (i32)tiles_y;
+		shift_x -= (f32)shift_x > tiles_x;
+		shift_y -= (f32)shift_y > tiles_y;
+		const f32 x = e_position->x[e] - (f32)shift_x * tile_size;
+		const f32 y = e_position->y[e] - (f32)shift_y * tile_size;
+
+		/* A tiny negative offset rounds up to exactly tile_size. */
+		const bool is_x_over = x >= tile_size;
+		const bool is_y_over = y >= tile_size;
+		e_position->tile_x[e] += shift_x + is_x_over;
+		e_position->tile_y[e] += shift_y + is_y_over;
+		e_position->x[e] = is_x_over ? x - tile_size : x;
+		e_position->y[e] = is_y_over ? y - tile_size : y;
+	}
+}
@@ -1,11 +1,16 @@
-#include <math/math_helpers.h>
+#include <math/soa_math.h>
 #include <soa.h>
 #include <soa_components_color.h>
 #include <soa_components_graphics.h>
 #include <soa_components_shape.h>
 #include <soa_components_transform.h>
+#include <soa_components_vertex.h>
 #include <soa_systems_vertex.h>
 
+/*
+ * Every face is a quad in the corner order of soa_get_quad_index, wound like
+ * the sprites when seen from outside the cube.
+ */
 void soa_make_cube(
 	soa_position3 *v_position,
 	soa_color1 *v_color,
@@ -26,21 +31,21 @@ void soa_make_cube(
 		{ 1.0f, 1.0f, 1.0f },
 		{ -1.0f, 1.0f, 1.0f }
 	};
-	static const int indices[36] = {
-		0, 1, 2, 2, 3, 0,
-		1, 5, 6, 6, 2, 1,
-		5, 4, 7, 7, 6, 5,
-		4, 0, 3, 3, 7, 4,
-		3, 2, 6, 6, 7, 3,
-		4, 5, 1, 1, 0, 4
+	static const int quads[24] = {
+		0, 3, 1, 2,
+		1, 2, 5, 6,
+		5, 6, 4, 7,
+		4, 7, 0, 3,
+		3, 7, 2, 6,
+		4, 0, 5, 1
 	};
-	for (usize i = 0; i < 36; i++) {
+	for (usize i = 0; i < 24; i++) {
 		const usize v = soa_new_slot1(vertex_entity).idx;
-		const f32v3 cube_vertex = vertices[indices[i]];
+		const f32v3 cube_vertex = vertices[quads[i]];
 		v_position->x[v] = cube_vertex.x * size + position.x;
 		v_position->y[v] = cube_vertex.y * size + position.y;
 		v_position->z[v] = cube_vertex.z * size + position.z;
-		v_color->val[i] = (u8v4) {
+		v_color->val[v] = (u8v4) {
 			(i + 0) * 100 + 50,
 			(i + 1) * 100 + 50,
 			(i + 2) * 100 + 50,
@@ -49,62 +54,145 @@ void soa_make_cube(
 	}
 }
 
-void soa_make_sprite_vertices(
+/*
+ * Quads share their vertices between the two triangles, top left, bottom
+ * left, top right then bottom left, bottom right, top right. The pattern only
+ * depends on the quad index, so one buffer, filled on first use, serves every
+ * quad of every vertex set and of the render queue.
+ */
+const int *soa_get_quad_index(
+	void)
+{
+	static int index[6 * SOA_QUAD_LIMIT];
+	static bool is_filled = false;
+	if (!is_filled) {
+		for (usize q = 0; q < SOA_QUAD_LIMIT; q++) {
+			const int v = (int)(q * 4);
+			index[q * 6 + 0] = v + 0;
+			index[q * 6 + 1] = v + 1;
+			index[q * 6 + 2] = v + 2;
+			index[q * 6 + 3] = v + 1;
+			index[q * 6 + 4] = v + 3;
+			index[q * 6 + 5] = v + 2;
+		}
+		is_filled = true;
+	}
+	return index;
+}
+
+enum {
+	VERTEX_CHUNK = 256,
+};
+
+/*
+ * Corners of every sprite, in the order top left, bottom left, top right and
+ * bottom right, rotated about the sprite center in one batch per corner.
+ */
+static void make_sprite_corners(
+	const f32 *position_x,
+	const f32 *position_y,
+	const f32 *width,
+	const f32 *height,
+	const f32 *rotation,
+	const usize entity_count,
+	f32 out_x[4][entity_count],
+	f32 out_y[4][entity_count])
+{
+	f32 origin_x[entity_count];
+	f32 origin_y[entity_count];
+	f32 sin[entity_count];
+	f32 cos[entity_count];
+
+	for (usize e = 0; e < entity_count; e++) {
+		const f32 w = width[e];
+		const f32 h = height[e];
+		const f32 x = position_x[e] - w * 0.5f;
+		const f32 y = position_y[e] - h;
+		out_x[0][e] = x;
+		out_y[0][e] = y;
+		out_x[1][e] = x;
+		out_y[1][e] = y + h;
+		out_x[2][e] = x + w;
+		out_y[2][e] = y;
+		out_x[3][e] = x + w;
+		out_y[3][e] = y + h;
+		origin_x[e] = x + w * 0.5f;
+		origin_y[e] = y + h * 0.5f;
+	}
+	soa_f32_sincos(sin, cos, rotation, entity_count);
+
+	for (usize c = 0; c < 4; c++) {
+		soa_f32_rotate2(out_x[c], out_y[c], out_x[c], out_y[c], origin_x, origin_y, sin, cos, entity_count);
+	}
+}
+
+static usize count_sprite_quads(
+	const soa_size2 *e_size,
+	const usize begin,
+	const usize count)
+{
+	f32 width[count];
+	f32 height[count];
+	soa_f16_load(width, e_size->w + begin, count);
+	soa_f16_load(height, e_size->h + begin, count);
+
+	usize quad_count = 0;
+	for (usize i = 0; i < count; i++) {
+		quad_count += width[i] > 0.f && height[i] > 0.f;
+	}
+	return quad_count;
+}
+
+/*
+ * Fills the vertices of one chunk of sprites from first_vertex up to
+ * end_vertex. The 3D variant stands the sprite up, its bottom corners get a
+ * depth of the sprite width.
+ */
+static void make_sprite_quads_chunk(
 	const soa_position2 *e_position,
 	const soa_rotation1 *e_rotation,
 	const soa_size2 *e_size,
 	const soa_clip *e_clip,
 	const soa_color *e_color,
-	usize entity_count,
-	soa_position2 *v_position,
+	const usize begin,
+	const usize count,
+	soa_position3 *v_position,
 	soa_color1 *v_color,
 	soa_texcoord *v_texcoord,
-	soa_entity_t *vertex_entity,
-	f32v2 texture_size)
+	const usize first_vertex,
+	const usize end_vertex,
+	const f32v2 texture_size,
+	const bool is_3d)
 {
-	for (usize e = 0; e < entity_count; e++) {
-		const usize v0 = soa_new_slot1(vertex_entity).idx;
-		const usize v1 = soa_new_slot1(vertex_entity).idx;
-		const usize v2 = soa_new_slot1(vertex_entity).idx;
-		const usize v3 = soa_new_slot1(vertex_entity).idx;
-		const usize v4 = soa_new_slot1(vertex_entity).idx;
-		const usize v5 = soa_new_slot1(vertex_entity).idx;
+	f32 width[count];
+	f32 height[count];
+	f32 rotation[count];
+	soa_f16_load(width, e_size->w + begin, count);
+	soa_f16_load(height, e_size->h + begin, count);
+	soa_f16_load(rotation, e_rotation->x + begin, count);
+
+	f32 corner_x[4][count];
+	f32 corner_y[4][count];
+	make_sprite_corners(e_position->x + begin, e_position->y + begin, width, height, rotation, count,
+		corner_x, corner_y);
+
+	usize v = first_vertex;
+	for (usize i = 0; i < count && v < end_vertex; i++) {
+		if (!(width[i] > 0.f && height[i] > 0.f)) continue;
+		const usize e = begin + i;
 
 		/* Vertex positions. */
-		const f32 w = e_size->w[e];
-		const f32 h = e_size->h[e];
-		const f32 x = e_position->x[e] - w * 0.5f;
-		const f32 y = e_position->y[e] - h;
-		const f32 rad = e_rotation->x[e];
-
-		f32v2 p0 = { x, y };
-		f32v2 p1 = { x, y + h };
-		f32v2 p2 = { x + w, y };
-		f32v2 p3 = { x + w, y + h };
-		if (rad != 0.f) {
-			const bool is_centered = true;
-			const f32v2 origin = {
-				is_centered ? x + w * 0.5f : x,
-				is_centered ? y + h * 0.5f : y,
-			};
-			p0 = rotate_about(p0, origin, rad);
-			p1 = rotate_about(p1, origin, rad);
-			p2 = rotate_about(p2, origin, rad);
-			p3 = rotate_about(p3, origin, rad);
+		const f32 z = is_3d ? width[i] : 0.f;
+		for (usize c = 0; c < 4; c++) {
+			v_position->x[v + c] = corner_x[c][i];
+			v_position->y[v + c] = corner_y[c][i];
+		}
+		if (is_3d) {
+			v_position->z[v + 0] = 0.f;
+			v_position->z[v + 1] = 0.f;
+			v_position->z[v + 2] = z;
+			v_position->z[v + 3] = z;
 		}
-
-		v_position->x[v0] = p0.x;
-		v_position->y[v0] = p0.y;
-		v_position->x[v1] = p1.x;
-		v_position->y[v1] = p1.y;
-		v_position->x[v2] = p2.x;
-		v_position->y[v2] = p2.y;
-		v_position->x[v3] = p1.x;
-		v_position->y[v3] = p1.y;
-		v_position->x[v4] = p3.x;
-		v_position->y[v4] = p3.y;
-		v_position->x[v5] = p2.x;
-		v_position->y[v5] = p2.y;
 
 		/* Texture coordinates. */
 		const f32rect tex = {
@@ -118,18 +206,14 @@ void soa_make_sprite_vertices(
 		const f32 t1 = tex.y;
 		const f32 t2 = tex.y + tex.h;
 
-		v_texcoord->s[v0] = s1;
-		v_texcoord->t[v0] = t1;
-		v_texcoord->s[v1] = s1;
-		v_texcoord->t[v1] = t2;
-		v_texcoord->s[v2] = s2;
-		v_texcoord->t[v2] = t1;
-		v_texcoord->s[v3] = s1;
-		v_texcoord->t[v3] = t2;
-		v_texcoord->s[v4] = s2;
-		v_texcoord->t[v4] = t2;
-		v_texcoord->s[v5] = s2;
-		v_texcoord->t[v5] = t1;
+		v_texcoord->s[v + 0] = s1;
+		v_texcoord->t[v + 0] = t1;
+		v_texcoord->s[v + 1] = s1;
+		v_texcoord->t[v + 1] = t2;
+		v_texcoord->s[v + 2] = s2;
+		v_texcoord->t[v + 2] = t1;
+		v_texcoord->s[v + 3] = s2;
+		v_texcoord->t[v + 3] = t2;
 
 		/* Color. */
 		const u8v4 rgba = {
@@ -139,16 +223,93 @@ void soa_make_sprite_vertices(
 			e_color->a[e],
 		};
 
-		v_color->val[v0] = rgba;
-		v_color->val[v1] = rgba;
-		v_color->val[v2] = rgba;
-		v_color->val[v3] = rgba;
-		v_color->val[v4] = rgba;
-		v_color->val[v5] = rgba;
+		v_color->val[v + 0] = rgba;
+		v_color->val[v + 1] = rgba;
+		v_color->val[v + 2] = rgba;
+		v_color->val[v + 3] = rgba;
+		v += 4;
+	}
+}
+
+/*
+ * Every chunk counts its non-empty sprites, an exclusive prefix sum over the
+ * counts gives each chunk its own vertex range, then the chunks fill their
+ * ranges independently. Returns the number of quads made, quads past the
+ * vertex limit are dropped.
+ */
+static usize make_sprite_quads(
+	const soa_position2 *e_position,
+	const soa_rotation1 *e_rotation,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const soa_color *e_color,
+	const usize entity_count,
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	soa_entity_t *vertex_entity,
+	const f32v2 texture_size,
+	const bool is_3d)
+{
+	const usize chunk_count = (entity_count + VERTEX_CHUNK - 1) / VERTEX_CHUNK;
+	usize chunk_quads[chunk_count + 1];
+
+#pragma omp parallel for if (chunk_count > 1) schedule(static)
+	for (usize c = 0; c < chunk_count; c++) {
+		const usize begin = c * VERTEX_CHUNK;
+		const usize count = entity_count - begin < VERTEX_CHUNK ? entity_count - begin : VERTEX_CHUNK;
+		chunk_quads[c] = count_sprite_quads(e_size, begin, count);
+	}
+
+	usize quad_count = 0;
+	for (usize c = 0; c < chunk_count; c++) {
+		quad_count += chunk_quads[c];
+	}
+	soa_slot_range_t range = soa_new_slots(vertex_entity, quad_count * 4);
+	while (range.count % 4 != 0) {
+		/* a partial quad at the limit goes back */
+		const soa_slot_t last = { range.idx + --range.count };
+		soa_free_slot(vertex_entity, &last, 1);
 	}
+
+	const usize limit = (usize)range.idx + range.count;
+	usize first_vertex[chunk_count + 1];
+	usize v = range.idx;
+	for (usize c = 0; c < chunk_count; c++) {
+		first_vertex[c] = v < limit ? v : limit;
+		v += chunk_quads[c] * 4;
+	}
+	first_vertex[chunk_count] = limit;
+
+#pragma omp parallel for if (chunk_count > 1) schedule(static)
+	for (usize c = 0; c < chunk_count; c++) {
+		if (first_vertex[c] == first_vertex[c + 1]) continue;
+		const usize begin = c * VERTEX_CHUNK;
+		const usize count = entity_count - begin < VERTEX_CHUNK ? entity_count - begin : VERTEX_CHUNK;
+		make_sprite_quads_chunk(e_position, e_rotation, e_size, e_clip, e_color, begin, count,
+			v_position, v_color, v_texcoord, first_vertex[c], first_vertex[c + 1], texture_size, is_3d);
+	}
+	return range.count / 4;
+}
+
+usize soa_make_sprite_vertices(
+	const soa_position2 *e_position,
+	const soa_rotation1 *e_rotation,
+	const soa_size2 *e_size,
+	const soa_clip *e_clip,
+	const soa_color *e_color,
+	usize entity_count,
+	soa_position2 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	soa_entity_t *vertex_entity,
+	f32v2 texture_size)
+{
+	return make_sprite_quads(e_position, e_rotation, e_size, e_clip, e_color, entity_count,
+		v_position, v_color, v_texcoord, vertex_entity, texture_size, false);
 }
 
-void soa_make_sprite_vertices_3d(
+usize soa_make_sprite_vertices_3d(
 	const soa_position2 *e_position,
 	const soa_rotation1 *e_rotation,
 	const soa_size2 *e_size,
@@ -161,94 +322,104 @@ void soa_make_sprite_vertices_3d(
 	soa_entity_t *vertex_entity,
 	f32v2 texture_size)
 {
-	for (usize e = 0; e < entity_count; e++) {
-		const usize v0 = soa_new_slot1(vertex_entity).idx;
-		const usize v1 = soa_new_slot1(vertex_entity).idx;
-		const usize v2 = soa_new_slot1(vertex_entity).idx;
-		const usize v3 = soa_new_slot1(vertex_entity).idx;
-		const usize v4 = soa_new_slot1(vertex_entity).idx;
-		const usize v5 = soa_new_slot1(vertex_entity).idx;
+	return make_sprite_quads(e_position, e_rotation, e_size, e_clip, e_color, entity_count,
+		v_position, v_color, v_texcoord, vertex_entity, texture_size, true);
+}
 
-		/* Vertex positions. */
-		const f32 w = e_size->w[e];
-		const f32 h = e_size->h[e];
-		const f32 x = e_position->x[e] - w * 0.5f;
-		const f32 y = e_position->y[e] - h;
-		const f32 rad = e_rotation->x[e];
-
-		f32v2 p0 = { x, y };
-		f32v2 p1 = { x, y + h };
-		f32v2 p2 = { x + w, y };
-		f32v2 p3 = { x + w, y + h };
-		if (rad != 0.f) {
-			const bool is_centered = true;
-			const f32v2 origin = {
-				is_centered ? x + w * 0.5f : x,
-				is_centered ? y + h * 0.5f : y,
-			};
-			p0 = rotate_about(p0, origin, rad);
-			p1 = rotate_about(p1, origin, rad);
-			p2 = rotate_about(p2, origin, rad);
-			p3 = rotate_about(p3, origin, rad);
-		}
+/*
+ * Sprites stand on the lowest edge of their quad, so quads are keyed by their
+ * largest y and moved from the top of the screen down, the ones in front
+ * last. The vertices are reordered rather than the indices, so the sorted set
+ * still draws with soa_get_quad_index.
+ */
+void soa_sort_quads_by_y(
+	soa_position3 *v_position,
+	soa_color1 *v_color,
+	soa_texcoord *v_texcoord,
+	const usize vertex_count)
+{
+	const usize quad_count = vertex_count / 4;
+	if (quad_count == 0) {
+		return;
+	}
 
-		v_position->x[v0] = p0.x;
-		v_position->y[v0] = p0.y;
-		v_position->z[v0] = 0;
-		v_position->x[v1] = p1.x;
-		v_position->y[v1] = p1.y;
-		v_position->z[v1] = 0;
-		v_position->x[v2] = p2.x;
-		v_position->y[v2] = p2.y;
-		v_position->z[v2] = w;
-		v_position->x[v3] = p1.x;
-		v_position->y[v3] = p1.y;
-		v_position->z[v3] = 0;
-		v_position->x[v4] = p3.x;
-		v_position->y[v4] = p3.y;
-		v_position->z[v4] = w;
-		v_position->x[v5] = p2.x;
-		v_position->y[v5] = p2.y;
-		v_position->z[v5] = w;
+	f32 bottom[quad_count];
+	const f32 *y = v_position->y;
+	for (usize q = 0; q < quad_count; q++) {
+		const f32 y01 = y[q * 4 + 0] > y[q * 4 + 1] ? y[q * 4 + 0] : y[q * 4 + 1];
+		const f32 y23 = y[q * 4 + 2] > y[q * 4 + 3] ? y[q * 4 + 2] : y[q * 4 + 3];
+		bottom[q] = y01 > y23 ? y01 : y23;
+	}
 
-		/* Texture coordinates. */
-		const f32rect tex = {
-			(e_clip->x[e] / texture_size.x),
-			(e_clip->y[e] / texture_size.y),
-			(e_clip->w[e] / texture_size.x),
-			(e_clip->h[e] / texture_size.y),
-		};
-		const f32 s1 = tex.x;
-		const f32 s2 = tex.x + tex.w;
-		const f32 t1 = tex.y;
-		const f32 t2 = tex.y + tex.h;
+	u32 key[quad_count], key_swap[quad_count];
+	u32 quad[quad_count], quad_swap[quad_count];
+	soa_f32_sort_key(key, bottom, quad_count);
+	for (usize q = 0; q < quad_count; q++) {
+		quad[q] = (u32)q;
+	}
+	soa_u32_radix_sort(key, quad, key_swap, quad_swap, quad_count);
 
-		v_texcoord->s[v0] = s1;
-		v_texcoord->t[v0] = t1;
-		v_texcoord->s[v1] = s1;
-		v_texcoord->t[v1] = t2;
-		v_texcoord->s[v2] = s2;
-		v_texcoord->t[v2] = t1;
-		v_texcoord->s[v3] = s1;
-		v_texcoord->t[v3] = t2;
-		v_texcoord->s[v4] = s2;
-		v_texcoord->t[v4] = t2;
-		v_texcoord->s[v5] = s2;
-		v_texcoord->t[v5] = t1;
+	const usize count = quad_count * 4;
+	f32 from_x[count], from_y[count], from_z[count], from_s[count], from_t[count];
+	u8v4 from_color[count];
+	for (usize v = 0; v < count; v++) {
+		from_x[v] = v_position->x[v];
+		from_y[v] = v_position->y[v];
+		from_z[v] = v_position->z[v];
+		from_s[v] = v_texcoord->s[v];
+		from_t[v] = v_texcoord->t[v];
+		from_color[v] = v_color->val[v];
+	}
+	for (usize v = 0; v < count; v++) {
+		const usize from = quad[v / 4] * 4 + v % 4;
+		v_position->x[v] = from_x[from];
+		v_position->y[v] = from_y[from];
+		v_position->z[v] = from_z[from];
+		v_texcoord->s[v] = from_s[from];
+		v_texcoord->t[v] = from_t[from];
+		v_color->val[v] = from_color[from];
+	}
+}
 
-		/* Color. */
-		const u8v4 rgba = {
-			e_color->r[e],
-			e_color->g[e],
-			e_color->b[e],
-			e_color->a[e],
-		};
+/*
+ * Painter's order for the triangles of soa_clip_triangles_3d, whose vertex z
+ * is the view depth: the farthest centroid first. Negating the summed depth
+ * turns that into an ascending sort.
+ */
+void soa_sort_triangles_by_depth(
+	const soa_position3 *v_position,
+	soa_triangle_index *index)
+{
+	const usize triangle_count = index->count / 3;
+	if (triangle_count == 0) {
+		return;
+	}
+
+	f32 depth[triangle_count];
+	const f32 *z = v_position->z;
+	for (usize t = 0; t < triangle_count; t++) {
+		const int *corner = &index->val[t * 3];
+		depth[t] = -(z[corner[0]] + z[corner[1]] + z[corner[2]]);
+	}
+
+	u32 key[triangle_count], key_swap[triangle_count];
+	u32 triangle[triangle_count], triangle_swap[triangle_count];
+	soa_f32_sort_key(key, depth, triangle_count);
+	for (usize t = 0; t < triangle_count; t++) {
+		triangle[t] = (u32)t;
+	}
+
+	int triangle_index[triangle_count * 3];
+	for (usize i = 0; i < triangle_count * 3; i++) {
+		triangle_index[i] = index->val[i];
+	}
+
+	soa_u32_radix_sort(key, triangle, key_swap, triangle_swap, triangle_count);
 
-		v_color->val[v0] = rgba;
-		v_color->val[v1] = rgba;
-		v_color->val[v2] = rgba;
-		v_color->val[v3] = rgba;
-		v_color->val[v4] = rgba;
-		v_color->val[v5] = rgba;
+	for (usize i = 0; i < triangle_count; i++) {
+		const int *corner = &triangle_index[triangle[i] * 3];
+		index->val[i * 3 + 0] = corner[0];
+		index->val[i * 3 + 1] = corner[1];
+		index->val[i * 3 + 2] = corner[2];
 	}
 }
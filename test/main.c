@@ -1,3 +1,1160 @@
+#include <cglm/cglm.h>
+#include <math/soa_fixed.h>
+#include <math/soa_math.h>
+#include <soa.h>
+#include <soa_components_color.h>
+#include <soa_components_graphics.h>
+#include <soa_components_sdl2.h>
+#include <soa_components_shape.h>
+#include <soa_components_spatial.h>
+#include <soa_components_transform.h>
+#include <soa_components_vertex.h>
+#include <soa_entities_tds.h>
+#include <soa_systems_camera.h>
+#include <soa_systems_movement.h>
+#include <soa_systems_physics.h>
+#include <soa_systems_sdl2.h>
+#include <soa_systems_spatial.h>
+#include <soa_systems_tilemap.h>
+#include <soa_systems_transform.h>
+#include <soa_systems_vertex.h>
+#include <tilemap.h>
 #include <utest.h>
 
+/* Odd count so that every kernel also runs its scalar tail. */
+#define SOA_MATH_TEST_COUNT 37
+
+static void soa_math_test_fill(f32 *out, usize count, f32 scale, f32 offset)
+{
+	for (usize i = 0; i < count; i++) {
+		out[i] = (f32)((i * 7919u) % 101u) * scale + offset;
+	}
+}
+
+UTEST(soa_math, add_scaled) {
+	f32 a[SOA_MATH_TEST_COUNT], b[SOA_MATH_TEST_COUNT], out[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(a, SOA_MATH_TEST_COUNT, 0.5f, -20.f);
+	soa_math_test_fill(b, SOA_MATH_TEST_COUNT, -0.25f, 3.f);
+	soa_f32_add_scaled(out, a, b, 1.f / 60.f, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_NEAR(a[i] + b[i] * (1.f / 60.f), out[i], 1e-5f);
+	}
+}
+
+UTEST(soa_math, mul_add_in_place) {
+	f32 a[SOA_MATH_TEST_COUNT], b[SOA_MATH_TEST_COUNT], c[SOA_MATH_TEST_COUNT], ref[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(a, SOA_MATH_TEST_COUNT, 1.f, 0.f);
+	soa_math_test_fill(b, SOA_MATH_TEST_COUNT, 0.1f, -5.f);
+	soa_math_test_fill(c, SOA_MATH_TEST_COUNT, 2.f, 1.f);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		ref[i] = a[i] + b[i] * c[i];
+	}
+	soa_f32_mul_add(a, a, b, c, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_NEAR(ref[i], a[i], 1e-4f);
+	}
+}
+
+UTEST(soa_math, lerp) {
+	f32 a[SOA_MATH_TEST_COUNT], b[SOA_MATH_TEST_COUNT], out[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(a, SOA_MATH_TEST_COUNT, 1.f, -50.f);
+	soa_math_test_fill(b, SOA_MATH_TEST_COUNT, -3.f, 100.f);
+	soa_f32_lerp(out, a, b, 0.25f, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_NEAR(a[i] + (b[i] - a[i]) * 0.25f, out[i], 1e-4f);
+	}
+}
+
+UTEST(soa_math, clamp) {
+	f32 a[SOA_MATH_TEST_COUNT], out[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(a, SOA_MATH_TEST_COUNT, 1.f, -50.f);
+	soa_f32_clamp(out, a, -10.f, 25.f, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		const f32 ref = a[i] < -10.f ? -10.f : a[i] > 25.f ? 25.f : a[i];
+		EXPECT_EQ(ref, out[i]);
+	}
+}
+
+UTEST(soa_math, length2) {
+	f32 x[SOA_MATH_TEST_COUNT], y[SOA_MATH_TEST_COUNT], out[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(x, SOA_MATH_TEST_COUNT, 1.5f, -70.f);
+	soa_math_test_fill(y, SOA_MATH_TEST_COUNT, -0.5f, 10.f);
+	soa_f32_length2(out, x, y, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_NEAR(sqrtf(x[i] * x[i] + y[i] * y[i]), out[i], 1e-4f);
+	}
+}
+
+UTEST(soa_math, normalize2) {
+	f32 x[SOA_MATH_TEST_COUNT], y[SOA_MATH_TEST_COUNT];
+	f32 out_x[SOA_MATH_TEST_COUNT], out_y[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(x, SOA_MATH_TEST_COUNT, 1.5f, -70.f);
+	soa_math_test_fill(y, SOA_MATH_TEST_COUNT, -0.5f, 10.f);
+	x[3] = 0.f; y[3] = 0.f;
+	x[SOA_MATH_TEST_COUNT - 1] = 0.f; y[SOA_MATH_TEST_COUNT - 1] = 0.f;
+	soa_f32_normalize2(out_x, out_y, x, y, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		const f32 length = sqrtf(x[i] * x[i] + y[i] * y[i]);
+		EXPECT_NEAR(length != 0.f ? x[i] / length : 0.f, out_x[i], 1e-6f);
+		EXPECT_NEAR(length != 0.f ? y[i] / length : 0.f, out_y[i], 1e-6f);
+	}
+	EXPECT_EQ(0.f, out_x[3]);
+	EXPECT_EQ(0.f, out_y[SOA_MATH_TEST_COUNT - 1]);
+}
+
+UTEST(soa_math, normalize2_fast_error) {
+	enum { count = 4099 };
+	static f32 x[count], y[count], fast_x[count], fast_y[count], exact_x[count], exact_y[count];
+	for (usize i = 0; i < count; i++) {
+		const f32 magnitude = powf(10.f, (f32)(i % 8) - 3.f);
+		x[i] = cosf((f32)i * 0.013f) * magnitude;
+		y[i] = sinf((f32)i * 0.013f) * magnitude;
+	}
+	x[7] = 0.f; y[7] = 0.f;
+	/* Squared lengths below FLT_MIN and past FLT_MAX, in vector lanes and in
+	 * the scalar tail. */
+	x[9] = 1e-20f; y[9] = 0.f;
+	x[10] = -3e-30f; y[10] = 4e-30f;
+	x[11] = 1e20f; y[11] = 0.f;
+	x[12] = 3e30f; y[12] = -4e30f;
+	x[count - 2] = 1e-20f; y[count - 2] = 0.f;
+	x[count - 1] = -3e30f; y[count - 1] = 4e30f;
+	soa_f32_normalize2_fast(fast_x, fast_y, x, y, count);
+	soa_f32_normalize2_exact(exact_x, exact_y, x, y, count);
+	for (usize i = 0; i < count; i++) {
+		EXPECT_NEAR(exact_x[i], fast_x[i], 1e-4f);
+		EXPECT_NEAR(exact_y[i], fast_y[i], 1e-4f);
+		if (i != 7) {
+			EXPECT_NEAR(1.f, sqrtf(fast_x[i] * fast_x[i] + fast_y[i] * fast_y[i]), 1e-4f);
+		}
+	}
+	EXPECT_EQ(0.f, fast_x[7]);
+	EXPECT_EQ(0.f, fast_y[7]);
+	EXPECT_NEAR(1.f, exact_x[9], 1e-6f);
+	EXPECT_NEAR(0.8f, exact_y[10], 1e-6f);
+	EXPECT_NEAR(1.f, exact_x[11], 1e-6f);
+	EXPECT_NEAR(-0.8f, exact_y[12], 1e-6f);
+	EXPECT_NEAR(1.f, fast_x[count - 2], 1e-6f);
+	EXPECT_NEAR(-0.6f, fast_x[count - 1], 1e-6f);
+}
+
+/* Not a check, prints the throughput of both normalize modes. */
+UTEST(soa_math, normalize2_benchmark) {
+	enum { count = 4096, rounds = 2000 };
+	static f32 x[count], y[count], out_x[count], out_y[count];
+	soa_math_test_fill(x, count, 1.f, -50.f);
+	soa_math_test_fill(y, count, -2.f, 100.f);
+
+	utest_int64_t exact_ns = utest_ns();
+	for (usize r = 0; r < rounds; r++) {
+		soa_f32_normalize2_exact(out_x, out_y, x, y, count);
+		x[r % count] = out_x[r % count];
+	}
+	exact_ns = utest_ns() - exact_ns;
+
+	utest_int64_t fast_ns = utest_ns();
+	for (usize r = 0; r < rounds; r++) {
+		soa_f32_normalize2_fast(out_x, out_y, x, y, count);
+		x[r % count] = out_x[r % count];
+	}
+	fast_ns = utest_ns() - fast_ns;
+
+	const f64 entities = (f64)count * rounds;
+	printf("normalize2 exact: %.2f entities/ns, fast: %.2f entities/ns\n",
+		entities / (f64)exact_ns, entities / (f64)fast_ns);
+	EXPECT_TRUE(exact_ns > 0 && fast_ns > 0);
+}
+
+UTEST(soa_math, rotate2) {
+	f32 x[SOA_MATH_TEST_COUNT], y[SOA_MATH_TEST_COUNT];
+	f32 ox[SOA_MATH_TEST_COUNT], oy[SOA_MATH_TEST_COUNT];
+	f32 s[SOA_MATH_TEST_COUNT], c[SOA_MATH_TEST_COUNT];
+	f32 out_x[SOA_MATH_TEST_COUNT], out_y[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(x, SOA_MATH_TEST_COUNT, 2.f, -100.f);
+	soa_math_test_fill(y, SOA_MATH_TEST_COUNT, -1.f, 40.f);
+	soa_math_test_fill(ox, SOA_MATH_TEST_COUNT, 0.5f, 0.f);
+	soa_math_test_fill(oy, SOA_MATH_TEST_COUNT, 0.25f, -10.f);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		s[i] = sinf((f32)i * 0.3f);
+		c[i] = cosf((f32)i * 0.3f);
+	}
+	soa_f32_rotate2(out_x, out_y, x, y, ox, oy, s, c, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		const f32 lx = x[i] - ox[i];
+		const f32 ly = y[i] - oy[i];
+		EXPECT_NEAR(c[i] * lx - s[i] * ly + ox[i], out_x[i], 1e-3f);
+		EXPECT_NEAR(s[i] * lx + c[i] * ly + oy[i], out_y[i], 1e-3f);
+	}
+}
+
+UTEST(soa_math, sincos) {
+	f32 rad[SOA_MATH_TEST_COUNT], out_sin[SOA_MATH_TEST_COUNT], out_cos[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(rad, SOA_MATH_TEST_COUNT, 0.37f, -18.f);
+	rad[0] = 0.f;
+	soa_f32_sincos(out_sin, out_cos, rad, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_NEAR(sinf(rad[i]), out_sin[i], 2e-7f);
+		EXPECT_NEAR(cosf(rad[i]), out_cos[i], 2e-7f);
+	}
+}
+
+UTEST(soa_math, atan2) {
+	f32 y[SOA_MATH_TEST_COUNT], x[SOA_MATH_TEST_COUNT], out[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(y, SOA_MATH_TEST_COUNT, 1.f, -50.f);
+	soa_math_test_fill(x, SOA_MATH_TEST_COUNT, -0.75f, 30.f);
+	y[0] = 0.f; x[0] = 0.f;
+	y[1] = 0.f; x[1] = -1.f;
+	soa_f32_atan2(out, y, x, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_NEAR(atan2f(y[i], x[i]), out[i], 4e-6f);
+	}
+}
+
+UTEST(soa_math, less_mask_and_select) {
+	f32 a[SOA_MATH_TEST_COUNT], b[SOA_MATH_TEST_COUNT], out[SOA_MATH_TEST_COUNT];
+	u32 mask[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(a, SOA_MATH_TEST_COUNT, 1.f, 0.f);
+	soa_math_test_fill(b, SOA_MATH_TEST_COUNT, -1.f, 100.f);
+	soa_f32_less_mask(mask, a, b, SOA_MATH_TEST_COUNT);
+	soa_f32_select(out, mask, a, b, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_EQ(a[i] < b[i] ? 0xffffffffu : 0u, mask[i]);
+		EXPECT_EQ(a[i] < b[i] ? a[i] : b[i], out[i]);
+	}
+}
+
+UTEST(soa_math, interleave2) {
+	f32 x[SOA_MATH_TEST_COUNT], y[SOA_MATH_TEST_COUNT], out[2 * SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(x, SOA_MATH_TEST_COUNT, 1.f, 0.f);
+	soa_math_test_fill(y, SOA_MATH_TEST_COUNT, -2.f, 7.f);
+	soa_f32_interleave2(out, x, y, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		EXPECT_EQ(x[i], out[2 * i + 0]);
+		EXPECT_EQ(y[i], out[2 * i + 1]);
+	}
+}
+
+UTEST(soa_math, radix_sort_f32_keys) {
+	f32 a[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(a, SOA_MATH_TEST_COUNT, -3.5f, 150.f);
+	a[0] = -0.f;
+	a[1] = 0.f;
+	a[2] = -INFINITY;
+	u32 key[SOA_MATH_TEST_COUNT], key_swap[SOA_MATH_TEST_COUNT];
+	u32 value[SOA_MATH_TEST_COUNT], value_swap[SOA_MATH_TEST_COUNT];
+	soa_f32_sort_key(key, a, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		value[i] = (u32)i;
+	}
+	soa_u32_radix_sort(key, value, key_swap, value_swap, SOA_MATH_TEST_COUNT);
+	for (usize i = 1; i < SOA_MATH_TEST_COUNT; i++) {
+		const f32 previous = a[value[i - 1]];
+		const f32 current = a[value[i]];
+		EXPECT_LE(previous, current);
+		if (previous == current && key[i - 1] == key[i]) {
+			EXPECT_LT(value[i - 1], value[i]);
+		}
+	}
+	EXPECT_EQ(2u, value[0]);
+}
+
+#ifndef F16_IS_F32
+UTEST(soa_math, f16_known_values) {
+	static const struct { f32 value; u16 bits; } cases[] = {
+		{ 0.f, 0x0000 },
+		{ -0.f, 0x8000 },
+		{ 1.f, 0x3c00 },
+		{ -2.f, 0xc000 },
+		{ 32.f, 0x5000 },
+		{ 65504.f, 0x7bff },
+		{ 65520.f, 0x7c00 },
+		{ INFINITY, 0x7c00 },
+		{ 1e-8f, 0x0000 },
+		{ 5.9604644775390625e-8f, 0x0001 },
+		{ 6.103515625e-5f, 0x0400 },
+		{ 1.f + 1.f / 1024.f, 0x3c01 },
+		{ 1.f + 1.f / 2048.f, 0x3c00 },
+		{ 1.f + 3.f / 2048.f, 0x3c02 },
+	};
+	enum { count = sizeof(cases) / sizeof(cases[0]) };
+	f32 values[count];
+	f16 halfs[count];
+	for (usize i = 0; i < count; i++) {
+		values[i] = cases[i].value;
+	}
+	soa_f16_store(halfs, values, count);
+	for (usize i = 0; i < count; i++) {
+		EXPECT_EQ(cases[i].bits, soa_f32_to_f16(cases[i].value)._);
+		EXPECT_EQ(cases[i].bits, halfs[i]._);
+	}
+}
+
+UTEST(soa_math, f16_round_trip) {
+	enum { count = 0x10000 };
+	static f16 halfs[count], round_trip[count];
+	static f32 values[count];
+	for (usize i = 0; i < count; i++) {
+		halfs[i] = (f16){ (u16)i };
+	}
+	soa_f16_load(values, halfs, count);
+	soa_f16_store(round_trip, values, count);
+	for (usize i = 0; i < count; i++) {
+		const bool is_nan = (i & 0x7c00u) == 0x7c00u && (i & 0x3ffu) != 0;
+		if (is_nan) {
+			EXPECT_TRUE(values[i] != values[i]);
+			continue;
+		}
+		EXPECT_EQ(soa_f16_to_f32(halfs[i]), values[i]);
+		EXPECT_EQ(halfs[i]._, round_trip[i]._);
+	}
+}
+#endif
+
+/* Not a check, prints where reading f16 columns starts to beat f32 columns. */
+UTEST(soa_math, f16_benchmark) {
+	enum { tile = 256, max_count = 1 << 22, elements = 1 << 24 };
+	f32 *w32 = malloc(max_count * sizeof(f32));
+	f32 *h32 = malloc(max_count * sizeof(f32));
+	f16 *w16 = malloc(max_count * sizeof(f16));
+	f16 *h16 = malloc(max_count * sizeof(f16));
+	ASSERT_TRUE(w32 && h32 && w16 && h16);
+	soa_math_test_fill(w32, max_count, 1.f, 1.f);
+	soa_math_test_fill(h32, max_count, 0.5f, 2.f);
+	soa_f16_store(w16, w32, max_count);
+	soa_f16_store(h16, h32, max_count);
+
+	f32 area[tile] = { 0 };
+	for (usize count = 4096; count <= max_count; count *= 4) {
+		const usize rounds = elements / count;
+
+		utest_int64_t f32_ns = utest_ns();
+		for (usize r = 0; r < rounds; r++) {
+			for (usize begin = 0; begin < count; begin += tile) {
+				soa_f32_mul_add(area, area, w32 + begin, h32 + begin, tile);
+			}
+		}
+		f32_ns = utest_ns() - f32_ns;
+
+		utest_int64_t f16_ns = utest_ns();
+		for (usize r = 0; r < rounds; r++) {
+			for (usize begin = 0; begin < count; begin += tile) {
+				f32 w[tile], h[tile];
+				soa_f16_load(w, w16 + begin, tile);
+				soa_f16_load(h, h16 + begin, tile);
+				soa_f32_mul_add(area, area, w, h, tile);
+			}
+		}
+		f16_ns = utest_ns() - f16_ns;
+
+		printf("f16 columns at %8zu entities: f32 %.3f ns/entity, f16 %.3f ns/entity\n", (size_t)count,
+			(f64)f32_ns / (f64)elements, (f64)f16_ns / (f64)elements);
+	}
+	EXPECT_TRUE(area[0] > 0.f);
+	free(w32);
+	free(h32);
+	free(w16);
+	free(h16);
+}
+
+UTEST(soa_fixed, sincos) {
+	f32 rad[SOA_MATH_TEST_COUNT];
+	q16 fixed_rad[SOA_MATH_TEST_COUNT], out_sin[SOA_MATH_TEST_COUNT], out_cos[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(rad, SOA_MATH_TEST_COUNT, 0.37f, -18.f);
+	soa_q16_from_f32(fixed_rad, rad, SOA_MATH_TEST_COUNT);
+	soa_q16_sincos(out_sin, out_cos, fixed_rad, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		const f64 r = (f64)fixed_rad[i] / SOA_Q16_ONE;
+		EXPECT_NEAR(sin(r), (f64)out_sin[i] / SOA_Q16_ONE, 1e-4);
+		EXPECT_NEAR(cos(r), (f64)out_cos[i] / SOA_Q16_ONE, 1e-4);
+	}
+}
+
+UTEST(soa_fixed, normalize2) {
+	f32 x[SOA_MATH_TEST_COUNT], y[SOA_MATH_TEST_COUNT];
+	q16 fixed_x[SOA_MATH_TEST_COUNT], fixed_y[SOA_MATH_TEST_COUNT];
+	q16 out_x[SOA_MATH_TEST_COUNT], out_y[SOA_MATH_TEST_COUNT];
+	soa_math_test_fill(x, SOA_MATH_TEST_COUNT, 1.5f, -70.f);
+	soa_math_test_fill(y, SOA_MATH_TEST_COUNT, -0.5f, 10.f);
+	x[3] = 0.f; y[3] = 0.f;
+	soa_q16_from_f32(fixed_x, x, SOA_MATH_TEST_COUNT);
+	soa_q16_from_f32(fixed_y, y, SOA_MATH_TEST_COUNT);
+	soa_q16_normalize2(out_x, out_y, fixed_x, fixed_y, SOA_MATH_TEST_COUNT);
+	for (usize i = 0; i < SOA_MATH_TEST_COUNT; i++) {
+		const f64 length = sqrt((f64)x[i] * x[i] + (f64)y[i] * y[i]);
+		EXPECT_NEAR(length != 0. ? x[i] / length : 0., (f64)out_x[i] / SOA_Q16_ONE, 1e-4);
+		EXPECT_NEAR(length != 0. ? y[i] / length : 0., (f64)out_y[i] / SOA_Q16_ONE, 1e-4);
+	}
+	EXPECT_EQ(0, out_x[3]);
+	EXPECT_EQ(0, out_y[3]);
+}
+
+/*
+ * Runs a small bullet simulation on integers only. The expected hash must
+ * come out of every compiler, optimization level and SIMD flag.
+ */
+UTEST(soa_fixed, simulation_hash) {
+	enum { count = 1000, steps = 600 };
+	static q16 position_x[count], position_y[count], rotation[count], speed[count];
+	static q16 sin[count], cos[count];
+	for (usize i = 0; i < count; i++) {
+		position_x[i] = (q16)(i * 97) * SOA_Q16_ONE / 8;
+		position_y[i] = -(q16)(i * 31) * SOA_Q16_ONE / 8;
+		rotation[i] = (q16)(i * 7919) - 400000;
+		speed[i] = (q16)(50 + i % 200) * SOA_Q16_ONE;
+	}
+	const q16 step = SOA_Q16_ONE / 60;
+	for (usize s = 0; s < steps; s++) {
+		soa_q16_sincos(sin, cos, rotation, count);
+		soa_q16_mul(sin, sin, speed, count);
+		soa_q16_mul(cos, cos, speed, count);
+		soa_q16_normalize2(sin, cos, sin, cos, count);
+		soa_q16_add_scaled(position_x, position_x, cos, step * 100, count);
+		soa_q16_add_scaled(position_y, position_y, sin, step * 100, count);
+		soa_q16_add_scaled(rotation, rotation, speed, step / 64, count);
+	}
+	u64 hash = 14695981039346656037ull;
+	hash = soa_q16_hash(hash, position_x, count);
+	hash = soa_q16_hash(hash, position_y, count);
+	hash = soa_q16_hash(hash, rotation, count);
+	EXPECT_EQ(0xb88f0967de6d3d3eull, hash);
+}
+
+UTEST(soa, new_slots_truncate) {
+	static soa_entity_t entity;
+	entity = (soa_entity_t){ .count = 1, .clear_count = 1 };
+	const soa_slot_range_t first = soa_new_slots(&entity, 10);
+	EXPECT_EQ(1u, first.idx);
+	EXPECT_EQ(10u, first.count);
+	EXPECT_TRUE(entity.is_occupied[10]);
+
+	const soa_slot_range_t rest = soa_new_slots(&entity, SOA_LIMIT);
+	EXPECT_EQ(11u, rest.idx);
+	EXPECT_EQ((u32)SOA_LIMIT - 11u, rest.count);
+	EXPECT_EQ((usize)SOA_LIMIT, entity.count);
+
+	const soa_slot_range_t none = soa_new_slots(&entity, 1);
+	EXPECT_EQ(0u, none.count);
+}
+
+/*
+ * Sprites of size 8 x 8 have a reach of 8 around their center, which sits 4
+ * above their position. Each pair is a sprite just inside and just outside
+ * one viewport edge, the count runs past the vector width into the tail.
+ */
+UTEST(soa_camera, visible_mask_edges) {
+	enum { count = 19 };
+	const f32v2 camera = { 100.f, 50.f };
+	const f32v2 viewport = { 320.f, 240.f };
+	const f32 e = 0.01f;
+	f32 x[count], y[count], w[count], h[count];
+	u32 mask[count];
+	u32 expected[count];
+	const f32 mid_x = camera.x + 160.f;
+	const f32 mid_y = camera.y + 120.f;
+	const f32 edges[8][2] = {
+		{ camera.x - 8.f + e, mid_y }, { camera.x - 8.f - e, mid_y },
+		{ camera.x + viewport.x + 8.f - e, mid_y }, { camera.x + viewport.x + 8.f + e, mid_y },
+		{ mid_x, camera.y - 4.f + e }, { mid_x, camera.y - 4.f - e },
+		{ mid_x, camera.y + viewport.y + 12.f - e }, { mid_x, camera.y + viewport.y + 12.f + e },
+	};
+	for (usize i = 0; i < count; i++) {
+		const usize edge = i % 8;
+		x[i] = edges[edge][0];
+		y[i] = edges[edge][1];
+		w[i] = 8.f;
+		h[i] = 8.f;
+		expected[i] = edge % 2 == 0 ? 0xffffffffu : 0u;
+	}
+	/* Empty sprites are never visible, even in the middle of the viewport. */
+	x[16] = mid_x;
+	y[16] = mid_y;
+	w[16] = 0.f;
+	expected[16] = 0u;
+
+	soa_get_visible_mask(x, y, w, h, count, camera, viewport, mask);
+	for (usize i = 0; i < count; i++) {
+		EXPECT_EQ(expected[i], mask[i]);
+	}
+}
+
+/* The folded viewport rows land where the full projection and viewport mapping do. */
+UTEST(soa_camera, camera_3d_matches_projection) {
+	static soa_position3 position, expected;
+	f32v3 camera = { 120.f, -40.f, -300.f };
+	const f32v2 viewport = { 640.f, 360.f };
+	soa_math_test_fill(position.x, SOA_MATH_TEST_COUNT, 9.f, -300.f);
+	soa_math_test_fill(position.y, SOA_MATH_TEST_COUNT, -5.f, 200.f);
+	soa_math_test_fill(position.z, SOA_MATH_TEST_COUNT, 4.f, -250.f);
+
+	f32v3 target = camera;
+	target.z += 1.f;
+	mat4 view, proj, mvp;
+	glm_lookat(camera.raw, target.raw, (vec3){ 0, -1, 0 }, view);
+	glm_perspective(glm_rad(60.f), viewport.width / viewport.height, 1.f, 10000.f, proj);
+	glm_mat4_mul(proj, view, mvp);
+	for (usize v = 0; v < SOA_MATH_TEST_COUNT; v++) {
+		vec4 clip;
+		glm_mat4_mulv(mvp, (vec4){ position.x[v], position.y[v], position.z[v], 1.f }, clip);
+		expected.x[v] = (clip[0] / clip[3] + 1.f) * 0.5f * viewport.width;
+		expected.y[v] = (1.f - clip[1] / clip[3]) * 0.5f * viewport.height;
+		expected.z[v] = clip[3];
+	}
+
+	soa_apply_camera_3d(&position, SOA_MATH_TEST_COUNT, camera, viewport);
+	for (usize v = 0; v < SOA_MATH_TEST_COUNT; v++) {
+		const f32 depth = position.z[v];
+		EXPECT_NEAR(expected.z[v], depth, 1e-3f);
+		EXPECT_NEAR(expected.x[v], position.x[v] / depth, 1e-2f);
+		EXPECT_NEAR(expected.y[v], position.y[v] / depth, 1e-2f);
+	}
+}
+
+/* One vertex as soa_apply_camera_3d leaves them, x and y not yet divided by w. */
+static void soa_camera_test_vertex(
+	soa_position3 *position,
+	soa_color1 *color,
+	soa_texcoord *texcoord,
+	soa_entity_t *entity,
+	f32 x,
+	f32 y,
+	f32 w,
+	f32 s,
+	f32 t,
+	u8 shade)
+{
+	const usize v = soa_new_slot1(entity).idx;
+	position->x[v] = x;
+	position->y[v] = y;
+	position->z[v] = w;
+	texcoord->s[v] = s;
+	texcoord->t[v] = t;
+	color->val[v] = (u8v4){ shade, shade, shade, 255 };
+}
+
+/*
+ * The top of the quad is in front of the near plane at w = 3, the bottom is
+ * behind it at w = -1, so every crossing is halfway along its edge. The first
+ * triangle keeps two corners and fans into two triangles, the second keeps one.
+ */
+UTEST(soa_camera, clip_straddling_near_plane) {
+	static soa_position3 position;
+	static soa_color1 color;
+	static soa_texcoord texcoord;
+	static soa_triangle_index index;
+	static soa_entity_t entity;
+	entity = (soa_entity_t){ 0 };
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 0.f, 0.f, 3.f, 0.f, 0.f, 0);
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 0.f, 40.f, -1.f, 0.f, 1.f, 200);
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 30.f, 0.f, 3.f, 1.f, 0.f, 0);
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 30.f, 40.f, -1.f, 1.f, 1.f, 200);
+
+	soa_clip_triangles_3d(&position, &color, &texcoord, &entity, &index);
+
+	/* Crossings of TL-BL, BL-TR, BR-TR and TR-BL, in the order they were found. */
+	ASSERT_EQ(8u, (u32)entity.count);
+	const f32 expected[4][4] = {
+		{ 0.f, 20.f, 0.f, 0.5f },
+		{ 15.f, 20.f, 0.5f, 0.5f },
+		{ 30.f, 20.f, 1.f, 0.5f },
+		{ 15.f, 20.f, 0.5f, 0.5f },
+	};
+	for (usize i = 0; i < 4; i++) {
+		const usize v = 4 + i;
+		EXPECT_NEAR(expected[i][0], position.x[v], 1e-4f);
+		EXPECT_NEAR(expected[i][1], position.y[v], 1e-4f);
+		EXPECT_EQ(1.f, position.z[v]);
+		EXPECT_NEAR(expected[i][2], texcoord.s[v], 1e-6f);
+		EXPECT_NEAR(expected[i][3], texcoord.t[v], 1e-6f);
+		EXPECT_EQ(100u, (u32)color.val[v].r);
+		EXPECT_EQ(255u, (u32)color.val[v].a);
+	}
+
+	const int expected_index[9] = { 0, 4, 5, 0, 5, 2, 6, 2, 7 };
+	ASSERT_EQ(9u, (u32)index.count);
+	for (usize i = 0; i < 9; i++) {
+		EXPECT_EQ(expected_index[i], index.val[i]);
+	}
+}
+
+/* A quad entirely behind the near plane leaves no triangle and no new vertex. */
+UTEST(soa_camera, clip_behind_near_plane) {
+	static soa_position3 position;
+	static soa_color1 color;
+	static soa_texcoord texcoord;
+	static soa_triangle_index index;
+	static soa_entity_t entity;
+	entity = (soa_entity_t){ 0 };
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 0.f, 0.f, 0.5f, 0.f, 0.f, 0);
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 0.f, 10.f, -2.f, 0.f, 1.f, 0);
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 10.f, 0.f, 0.99f, 1.f, 0.f, 0);
+	soa_camera_test_vertex(&position, &color, &texcoord, &entity, 10.f, 10.f, -2.f, 1.f, 1.f, 0);
+
+	soa_clip_triangles_3d(&position, &color, &texcoord, &entity, &index);
+
+	EXPECT_EQ(4u, (u32)entity.count);
+	EXPECT_EQ(0u, (u32)index.count);
+}
+
+/* The second quad is the first mirrored on x, so it faces away and is culled. */
+UTEST(soa_camera, cull_reversed_winding) {
+	static soa_position3 position;
+	static soa_color1 color;
+	static soa_texcoord texcoord;
+	static soa_triangle_index index;
+	static soa_entity_t entity;
+	entity = (soa_entity_t){ 0 };
+	for (usize q = 0; q < 2; q++) {
+		const f32 left = q == 0 ? 0.f : 10.f;
+		const f32 right = q == 0 ? 10.f : 0.f;
+		soa_camera_test_vertex(&position, &color, &texcoord, &entity, left, 0.f, 1.f, 0.f, 0.f, 0);
+		soa_camera_test_vertex(&position, &color, &texcoord, &entity, left, 10.f, 1.f, 0.f, 1.f, 0);
+		soa_camera_test_vertex(&position, &color, &texcoord, &entity, right, 0.f, 1.f, 1.f, 0.f, 0);
+		soa_camera_test_vertex(&position, &color, &texcoord, &entity, right, 10.f, 1.f, 1.f, 1.f, 0);
+	}
+
+	soa_clip_triangles_3d(&position, &color, &texcoord, &entity, &index);
+
+	EXPECT_EQ(8u, (u32)entity.count);
+	const int expected_index[6] = { 0, 1, 2, 1, 3, 2 };
+	ASSERT_EQ(6u, (u32)index.count);
+	for (usize i = 0; i < 6; i++) {
+		EXPECT_EQ(expected_index[i], index.val[i]);
+	}
+}
+
+/* Whole quads move to their sorted place, the shared index draws them as they come. */
+UTEST(soa_vertex, sort_quads_by_y) {
+	static soa_position3 position;
+	static soa_color1 color;
+	static soa_texcoord texcoord;
+	const f32 bottom[3] = { 30.f, 10.f, 20.f };
+	for (usize v = 0; v < 12; v++) {
+		const usize q = v / 4;
+		position.x[v] = (f32)v;
+		position.y[v] = bottom[q] - (f32)(3 - v % 4);
+		position.z[v] = 0.f;
+		texcoord.s[v] = (f32)q;
+		texcoord.t[v] = (f32)(v % 4);
+		color.val[v] = (u8v4){ (u8)q, 0, 0, 255 };
+	}
+	soa_sort_quads_by_y(&position, &color, &texcoord, 12);
+
+	const usize order[3] = { 1, 2, 0 };
+	for (usize v = 0; v < 12; v++) {
+		const usize q = order[v / 4];
+		const f32 corner = (f32)(v % 4);
+		EXPECT_EQ((f32)(q * 4) + corner, position.x[v]);
+		EXPECT_EQ((f32)q, texcoord.s[v]);
+		EXPECT_EQ(corner, texcoord.t[v]);
+		EXPECT_EQ((u32)q, (u32)color.val[v].r);
+	}
+
+	const int *index = soa_get_quad_index();
+	const int expected[12] = { 0, 1, 2, 1, 3, 2, 4, 5, 6, 5, 7, 6 };
+	for (usize i = 0; i < 12; i++) {
+		EXPECT_EQ(expected[i], index[i]);
+	}
+}
+
+/* Sprites of 16 x 16 at x, each its own clip, on a camera at the origin. */
+static void soa_render_queue_test_sprites(soa_render_queue *queue, SDL_Texture *texture, const f32 *x,
+	usize count, u8 layer)
+{
+	static soa_position2 position;
+	static soa_size2 size;
+	static soa_clip clip;
+	for (usize e = 0; e < count; e++) {
+		position.x[e] = x[e];
+		position.y[e] = 100.f;
+		size.w[e] = soa_f32_to_f16(16.f);
+		size.h[e] = soa_f32_to_f16(16.f);
+		clip.x[e] = (u16)(e * 16);
+		clip.y[e] = 0;
+		clip.w[e] = 16;
+		clip.h[e] = 16;
+	}
+	soa_queue_sprite(&position, &size, &clip, count, (f32v2){ 0.f, 0.f }, (f32v2){ 640.f, 480.f },
+		layer, texture, SDL_BLENDMODE_BLEND, (f32v2){ 256.f, 256.f }, queue);
+}
+
+/*
+ * Layers come first, then commands of a layer group by state in the order the
+ * states were first seen, and commands of one state keep their queue order.
+ */
+UTEST(soa_render_queue, layer_and_texture_order) {
+	static soa_render_queue queue;
+	static u8 texture_a_data, texture_b_data;
+	SDL_Texture *texture_a = (SDL_Texture *)&texture_a_data;
+	SDL_Texture *texture_b = (SDL_Texture *)&texture_b_data;
+	soa_init_render_queue(&queue);
+	soa_begin_render_queue(&queue, NULL);
+
+	soa_queue_fill_rect((f32rect){ 1.f, 1.f, 4.f, 4.f }, (u8v4){ 255, 0, 0, 255 }, 1, SDL_BLENDMODE_BLEND, &queue);
+	soa_render_queue_test_sprites(&queue, texture_a, (const f32[]){ 20.f, 40.f }, 2, 0);
+	soa_queue_fill_rect((f32rect){ 2.f, 2.f, 4.f, 4.f }, (u8v4){ 0, 255, 0, 255 }, 0, SDL_BLENDMODE_BLEND, &queue);
+	soa_render_queue_test_sprites(&queue, texture_b, (const f32[]){ 60.f }, 1, 0);
+	soa_render_queue_test_sprites(&queue, texture_a, (const f32[]){ 80.f }, 1, 0);
+	ASSERT_EQ((usize)6, queue.count);
+	soa_sort_render_queue(&queue);
+
+	/* The two runs of texture a merge, the layer 1 rect comes last. */
+	ASSERT_EQ((usize)4, queue.batch_count);
+	const u32 expected_first[4] = { 0, 1, 4, 5 };
+	const u32 expected_quads[4] = { 1, 3, 1, 1 };
+	SDL_Texture *expected_texture[4] = { NULL, texture_a, texture_b, NULL };
+	for (usize b = 0; b < 4; b++) {
+		EXPECT_EQ(expected_first[b], queue.batch[b].first_quad);
+		EXPECT_EQ(expected_quads[b], queue.batch[b].quad_count);
+		EXPECT_TRUE(queue.state[queue.batch[b].state].texture == expected_texture[b]);
+	}
+	EXPECT_EQ(2.f, queue.sorted_vertex[0].position.x);
+	EXPECT_EQ(20.f - 8.f, queue.sorted_vertex[4].position.x);
+	EXPECT_EQ(40.f - 8.f, queue.sorted_vertex[8].position.x);
+	EXPECT_EQ(80.f - 8.f, queue.sorted_vertex[12].position.x);
+	EXPECT_EQ(60.f - 8.f, queue.sorted_vertex[16].position.x);
+	EXPECT_EQ(1.f, queue.sorted_vertex[20].position.x);
+
+	EXPECT_EQ(6u, queue.stats.command_count);
+	EXPECT_EQ(4u, queue.stats.draw_count);
+	EXPECT_EQ(4u, queue.stats.texture_changes);
+	EXPECT_EQ(1u, queue.stats.blend_mode_changes);
+}
+
+/* Outlines are a command each, all of one layer merge into a single draw. */
+UTEST(soa_render_queue, outlines_merge) {
+	enum { count = 1500 };
+	static soa_render_queue queue;
+	static soa_position2 position;
+	static soa_size2 size;
+	static soa_color color;
+	for (usize e = 0; e < count; e++) {
+		position.x[e] = (f32)(e % 40) * 16.f + 8.f;
+		position.y[e] = (f32)(e / 40) * 12.f + 16.f;
+		size.w[e] = soa_f32_to_f16(16.f);
+		size.h[e] = soa_f32_to_f16(16.f);
+		color.r[e] = (u8)e;
+		color.g[e] = 0;
+		color.b[e] = 0;
+		color.a[e] = 255;
+	}
+	soa_init_render_queue(&queue);
+	soa_begin_render_queue(&queue, NULL);
+	soa_queue_rect(&position, &size, &color, count, (f32v2){ 0.f, 0.f }, (f32v2){ 1024.f, 1024.f },
+		2, SDL_BLENDMODE_BLEND, &queue);
+	soa_queue_fill_rect((f32rect){ 0.f, 0.f, 8.f, 8.f }, (u8v4){ 0, 0, 0, 255 }, 1, SDL_BLENDMODE_ADD, &queue);
+	ASSERT_EQ((usize)count + 1, queue.count);
+	ASSERT_EQ((usize)count * 4 + 1, queue.quad_count);
+	soa_sort_render_queue(&queue);
+
+	ASSERT_EQ((usize)2, queue.batch_count);
+	EXPECT_EQ(1u, queue.batch[0].quad_count);
+	EXPECT_EQ((u32)count * 4, queue.batch[1].quad_count);
+	EXPECT_EQ((u32)count + 1, queue.stats.command_count);
+	EXPECT_EQ(2u, queue.stats.draw_count);
+	EXPECT_EQ(1u, queue.stats.texture_changes);
+	EXPECT_EQ(2u, queue.stats.blend_mode_changes);
+	/* Every outline keeps its color on all four of its quads. */
+	EXPECT_EQ(1u, (u32)queue.sorted_vertex[4 + 16 + 15].color.r);
+}
+
+static f32 soa_spatial_test_brute_nearest2(const soa_position2 *position, usize count, f32 x, f32 y)
+{
+	f32 best = INFINITY;
+	for (usize e = 0; e < count; e++) {
+		const f32 dx = position->x[e] - x;
+		const f32 dy = position->y[e] - y;
+		best = fminf(best, dx * dx + dy * dy);
+	}
+	return best;
+}
+
+/* Queries inside, beside and very far from the grid find the brute force nearest. */
+UTEST(soa_spatial, nearest_matches_brute_force) {
+	enum { target_count = 100, query_count = 1000 };
+	static soa_position2 targets, queries;
+	static soa_entity_t entity;
+	static soa_spatial_grid grid;
+	static soa_slot_t nearest[query_count];
+	static u8bool found[query_count];
+
+	entity = (soa_entity_t){ 0 };
+	soa_math_test_fill(targets.x, target_count, 13.f, -400.f);
+	soa_math_test_fill(targets.y, target_count, 7.f, 200.f);
+	for (usize e = 0; e < target_count; e++) {
+		targets.x[e] += (f32)(e % 10) * 3.f;
+		soa_new_slot1(&entity);
+	}
+	soa_build_spatial_grid(&targets, &entity, 32.f, &grid);
+
+	for (usize q = 0; q < query_count; q++) {
+		const f32 spread = q < 900 ? 2000.f : 1e9f;
+		queries.x[q] = ((f32)((q * 7919u) % 1009u) / 1009.f - 0.5f) * spread;
+		queries.y[q] = ((f32)((q * 104729u) % 1013u) / 1013.f - 0.5f) * spread;
+	}
+	soa_find_nearest_in_spatial_grid(&queries, query_count, &grid, nearest, found);
+
+	for (usize q = 0; q < query_count; q++) {
+		ASSERT_TRUE(found[q]);
+		const f32 dx = targets.x[nearest[q].idx] - queries.x[q];
+		const f32 dy = targets.y[nearest[q].idx] - queries.y[q];
+		EXPECT_EQ(soa_spatial_test_brute_nearest2(&targets, target_count, queries.x[q], queries.y[q]),
+			dx * dx + dy * dy);
+	}
+}
+
+/* Not a check, prints grid and brute force time of 10k followers looking for 100 targets. */
+UTEST(soa_spatial, nearest_benchmark) {
+	enum { target_count = 100, follower_count = 10000, rounds = 20 };
+	static soa_position2 targets, followers;
+	static soa_entity_t entity;
+	static soa_spatial_grid grid;
+	static soa_slot_t nearest[SOA_LIMIT];
+	static u8bool found[SOA_LIMIT];
+
+	entity = (soa_entity_t){ 0 };
+	soa_math_test_fill(targets.x, target_count, 20.f, 0.f);
+	soa_math_test_fill(targets.y, target_count, 13.f, 0.f);
+	for (usize e = 0; e < target_count; e++) {
+		soa_new_slot1(&entity);
+	}
+	soa_math_test_fill(followers.x, SOA_LIMIT, 31.f, -500.f);
+	soa_math_test_fill(followers.y, SOA_LIMIT, 17.f, -300.f);
+
+	utest_int64_t grid_ns = utest_ns();
+	for (usize r = 0; r < rounds; r++) {
+		soa_build_spatial_grid(&targets, &entity, 32.f, &grid);
+		for (usize begin = 0; begin < follower_count; begin += SOA_LIMIT) {
+			const usize count = follower_count - begin < SOA_LIMIT ? follower_count - begin : SOA_LIMIT;
+			soa_find_nearest_in_spatial_grid(&followers, count, &grid, nearest, found);
+		}
+	}
+	grid_ns = utest_ns() - grid_ns;
+
+	f32 sum = 0.f;
+	utest_int64_t brute_ns = utest_ns();
+	for (usize r = 0; r < rounds; r++) {
+		for (usize f = 0; f < follower_count; f++) {
+			const usize q = f % SOA_LIMIT;
+			sum += soa_spatial_test_brute_nearest2(&targets, target_count, followers.x[q], followers.y[q]);
+		}
+	}
+	brute_ns = utest_ns() - brute_ns;
+
+	const f64 queries = (f64)follower_count * rounds;
+	printf("nearest of %d targets: grid %.1f ns/follower, brute force %.1f ns/follower\n", target_count,
+		(f64)grid_ns / queries, (f64)brute_ns / queries);
+	EXPECT_TRUE(found[0] && sum > 0.f);
+}
+
+/*
+ * Offsets on both sides of every tile edge, including the ones that round to
+ * the edge, all come back inside [0, tile_size) and keep their world position.
+ */
+UTEST(soa_transform, renormalize_lwc_invariant) {
+	static soa_lwc_position2 position;
+	const f32 tile_size = 32.f;
+	const f32 offsets[] = {
+		-1e-7f, -1e-6f, 1e-7f, 0.f, 31.99999f, 31.999999f, 32.f, -32.f, -32.00001f,
+		64.5f, -1000.25f, 123456.7f, -123456.7f,
+	};
+	enum { count = sizeof(offsets) / sizeof(offsets[0]) };
+	for (usize e = 0; e < count; e++) {
+		position.tile_x[e] = (i32)e - 5;
+		position.tile_y[e] = 1000000;
+		position.x[e] = offsets[e];
+		position.y[e] = -offsets[e];
+	}
+	soa_renormalize_lwc_position2(&position, count, tile_size);
+
+	for (usize e = 0; e < count; e++) {
+		EXPECT_TRUE(position.x[e] >= 0.f && position.x[e] < tile_size);
+		EXPECT_TRUE(position.y[e] >= 0.f && position.y[e] < tile_size);
+		const f64 world_x = (f64)((i32)e - 5) * tile_size + (f64)offsets[e];
+		const f64 world_y = 1000000. * tile_size - (f64)offsets[e];
+		EXPECT_NEAR(world_x, (f64)position.tile_x[e] * tile_size + (f64)position.x[e], 1e-2);
+		EXPECT_NEAR(world_y, (f64)position.tile_y[e] * tile_size + (f64)position.y[e], 1e-2);
+	}
+	/* -1e-7 rounds up to the edge of the previous tile, which wraps to this one. */
+	EXPECT_EQ(-5, position.tile_x[0]);
+	EXPECT_EQ(0.f, position.x[0]);
+}
+
+/*
+ * Ten million tiles out, an f32 position has a step of 32 pixels and ten
+ * seconds at 100 pixels a second do not move it at all. The large world
+ * position moves the full 1000 pixels and the camera sees it exactly. The
+ * step of 1/64 s is exact in Q16.16 too, so deterministic builds agree.
+ */
+UTEST(soa_transform, lwc_precision_far_from_origin) {
+	static soa_lwc_position2 position;
+	static soa_position2 view;
+	static soa_velocity2 velocity;
+	const f32 tile_size = 32.f;
+	const i32 far = 10000000;
+	const f32seconds dt = { 1.f / 64.f };
+	position.tile_x[0] = far;
+	position.tile_y[0] = -far;
+	position.x[0] = 0.25f;
+	position.y[0] = 0.25f;
+	velocity.x[0] = 100.f;
+	velocity.y[0] = -100.f;
+	f32 f32_x = (f32)far * tile_size + 0.25f;
+	for (usize step = 0; step < 640; step++) {
+		soa_apply_forwards_velocity_lwc(&position, &velocity, 1, dt);
+		soa_renormalize_lwc_position2(&position, 1, tile_size);
+		f32_x += velocity.x[0] * dt.seconds;
+	}
+
+	const lwc32v2 camera = { .x = { far, 0.f }, .y = { -far, 0.f } };
+	soa_apply_camera_2d_lwc(&position, 1, camera, tile_size, &view);
+	EXPECT_EQ(1000.25f, view.x[0]);
+	EXPECT_EQ(-999.75f, view.y[0]);
+	EXPECT_EQ((f32)far * tile_size, f32_x);
+}
+
+/* Contacts of the (a, b) pairs within one set, all kept in the given order. */
+static void soa_physics_test_contacts(
+	soa_contact2 *contacts,
+	const soa_position2 *position,
+	const soa_weight *weight,
+	const u32 *pairs,
+	const usize pair_count,
+	const f32 radius)
+{
+	soa_slot_t a[pair_count];
+	soa_slot_t b[pair_count];
+	f32 distance[pair_count];
+	for (usize i = 0; i < pair_count; i++) {
+		a[i].idx = pairs[2 * i];
+		b[i].idx = pairs[2 * i + 1];
+		const f32 dx = position->x[b[i].idx] - position->x[a[i].idx];
+		const f32 dy = position->y[b[i].idx] - position->y[a[i].idx];
+		distance[i] = sqrtf(dx * dx + dy * dy);
+	}
+	contacts->count = 0;
+	soa_add_contacts(contacts, position, weight, position, weight, a, b, distance, pair_count, radius, false);
+}
+
+/* Every impulse is applied equal and opposite, the weighted sum of velocities stays put. */
+UTEST(soa_physics, solve_contacts_momentum) {
+	enum { body_count = 6 };
+	static soa_position2 position;
+	static soa_weight weight;
+	static soa_velocity2 velocity;
+	static soa_contact2 contacts;
+	static const u32 pairs[] = { 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, 5, 4, 5, 0, 5 };
+	for (usize e = 0; e < body_count; e++) {
+		const f32 angle = (f32)e * 1.0472f;
+		position.x[e] = 9.f * cosf(angle);
+		position.y[e] = 9.f * sinf(angle);
+		weight.kg[e] = (f32)(e + 1);
+		velocity.x[e] = (f32)e * 3.f - 7.f;
+		velocity.y[e] = 5.f - (f32)e * 2.f;
+	}
+	soa_physics_test_contacts(&contacts, &position, &weight, pairs, sizeof(pairs) / sizeof(pairs[0]) / 2, 16.f);
+
+	f64 before_x = 0., before_y = 0.;
+	for (usize e = 0; e < body_count; e++) {
+		before_x += (f64)(weight.kg[e] * velocity.x[e]);
+		before_y += (f64)(weight.kg[e] * velocity.y[e]);
+	}
+	soa_solve_contacts(&contacts, &velocity, &velocity, 4, (f32seconds){ 1.f / 60.f });
+	f64 after_x = 0., after_y = 0., moved = 0.;
+	for (usize e = 0; e < body_count; e++) {
+		after_x += (f64)(weight.kg[e] * velocity.x[e]);
+		after_y += (f64)(weight.kg[e] * velocity.y[e]);
+		moved += fabs((f64)velocity.x[e]);
+	}
+	EXPECT_NEAR(before_x, after_x, 1e-2);
+	EXPECT_NEAR(before_y, after_y, 1e-2);
+	EXPECT_TRUE(moved > 0.);
+}
+
+/* Weight 0 bodies never move, a lone movable body takes the whole push. */
+UTEST(soa_physics, solve_contacts_immovable) {
+	static soa_position2 position;
+	static soa_weight weight;
+	static soa_velocity2 velocity;
+	static soa_contact2 contacts;
+	static const u32 pairs[] = { 0, 1, 2, 3 };
+	position.x[0] = 0.f;
+	position.x[1] = 10.f;
+	position.x[2] = 100.f;
+	position.x[3] = 100.f;
+	weight.kg[0] = 0.f;
+	weight.kg[1] = 2.f;
+	weight.kg[2] = 0.f;
+	weight.kg[3] = 0.f;
+	for (usize e = 0; e < 4; e++) {
+		position.y[e] = 0.f;
+		velocity.x[e] = 0.f;
+		velocity.y[e] = 0.f;
+	}
+	soa_physics_test_contacts(&contacts, &position, &weight, pairs, 2, 16.f);
+
+	soa_solve_contacts(&contacts, &velocity, &velocity, 4, (f32seconds){ 1.f / 60.f });
+	/* Overlap 6 minus the slop of 0.5, pushed out by a fifth every 1/60 s. */
+	const f32 target = 5.5f * 0.2f * 60.f;
+	EXPECT_EQ(0.f, velocity.x[0]);
+	EXPECT_EQ(0.f, velocity.y[0]);
+	EXPECT_NEAR(target, velocity.x[1], 1e-2f);
+	EXPECT_EQ(0.f, velocity.y[1]);
+	for (usize e = 2; e < 4; e++) {
+		EXPECT_EQ(0.f, velocity.x[e]);
+		EXPECT_EQ(0.f, velocity.y[e]);
+	}
+}
+
+/*
+ * A body pressed by four equal bodies from one side. Each contact gets a
+ * quarter of its impulse, so the first iteration moves 5/8 of the way and
+ * every following one closes 5/8 of the rest: 118 of a 120 target after four
+ * iterations, without ever going past it.
+ */
+UTEST(soa_physics, solve_contacts_many_per_body) {
+	enum { neighbour_count = 4 };
+	static soa_position2 position;
+	static soa_weight weight;
+	static soa_velocity2 velocity;
+	static soa_contact2 contacts;
+	static const u32 pairs[] = { 0, 1, 0, 2, 0, 3, 0, 4 };
+	for (usize e = 0; e <= neighbour_count; e++) {
+		position.x[e] = e == 0 ? 0.f : 5.5f;
+		position.y[e] = 0.f;
+		weight.kg[e] = 1.f;
+	}
+	soa_physics_test_contacts(&contacts, &position, &weight, pairs, neighbour_count, 16.f);
+	ASSERT_EQ(4u, (u32)contacts.count);
+
+	/* Overlap 10.5 minus the slop of 0.5. */
+	const f32 target = 10.f * 0.2f * 60.f;
+	f32 previous = 0.f;
+	for (usize iterations = 1; iterations <= 4; iterations++) {
+		for (usize e = 0; e <= neighbour_count; e++) {
+			velocity.x[e] = 0.f;
+			velocity.y[e] = 0.f;
+		}
+		soa_solve_contacts(&contacts, &velocity, &velocity, iterations, (f32seconds){ 1.f / 60.f });
+		const f32 separating = velocity.x[1] - velocity.x[0];
+		EXPECT_TRUE(separating > previous);
+		EXPECT_TRUE(separating <= target + 1e-3f);
+		previous = separating;
+	}
+	EXPECT_NEAR(118.f, previous, 0.5f);
+}
+
+#ifdef SOA_DETERMINISTIC
+/* The contact pass of the shooter tick. */
+static void soa_fixed_test_push_apart(
+	soa_contact2 *contacts,
+	soa_character *a,
+	const soa_spatial_grid *a_grid,
+	soa_character *b,
+	const soa_spatial_grid *b_grid,
+	const f32 radius,
+	const f32seconds dt)
+{
+	soa_push_apart(contacts, &a->position, &a->weight, &a->knockback, a_grid,
+		&b->position, &b->weight, &b->knockback, b_grid, radius, 4, dt);
+}
+
+/*
+ * Runs the movement, steering and contact systems of the shooter tick on a
+ * crowd packed tight enough to collide. The expected hash must come out of
+ * every compiler, optimization level and SIMD flag of a deterministic build.
+ */
+UTEST(soa_fixed, systems_hash) {
+	enum { monster_count = 600, barrel_count = 40, bullet_count = 200, steps = 300 };
+	enum { map_size = 64, tile = 32 };
+	static soa_character player, monster, barrel;
+	static soa_bullet bullet;
+	static soa_spatial_grid player_grid, monster_grid, barrel_grid;
+	static soa_contact2 contacts;
+	static f32 walking_speed[map_size * map_size];
+	for (usize i = 0; i < map_size * map_size; i++) {
+		walking_speed[i] = i % 7 == 0 ? 0.5f : 1.f;
+	}
+	const tilemap_t map = {
+		.width = map_size,
+		.height = map_size,
+		.collision_buffer = { walking_speed },
+	};
+	const i32v2 tile_size = { tile, tile };
+	const f32seconds dt = { 1.f / 60.f };
+	const f32 center = (f32)(map_size * tile) * 0.5f;
+
+	const soa_slot_t player_slot = soa_character_new1(&player, &(const soa_character_desc_t) {
+		.position = { center, center },
+		.speed = 400.f,
+	});
+	for (usize i = 0; i < monster_count; i++) {
+		soa_character_new1(&monster, &(const soa_character_desc_t) {
+			.position = { center - 400.f + (f32)((i * 37) % 800) + 0.25f, center - 400.f + (f32)((i * 91) % 800) },
+			.speed = 200.f,
+			.weight = 70.f,
+		});
+	}
+	for (usize i = 0; i < barrel_count; i++) {
+		soa_character_new1(&barrel, &(const soa_character_desc_t) {
+			.position = { center - 200.f + (f32)(i % 8) * 48.f, center - 200.f + (f32)(i / 8) * 80.f },
+			.weight = 150.f,
+		});
+	}
+	for (usize i = 0; i < bullet_count; i++) {
+		const soa_slot_t slot = soa_bullet_new1(&bullet, &(const soa_bullet_desc_t) {
+			.position = { center, center },
+			.destination = { center + 1.f, center },
+			.speed = 600.f,
+			.weight = 10.f,
+		});
+		/* Multiples of 1/64 survive the f16 rotation column unrounded. */
+		bullet.rotation.x[slot.idx] = soa_f32_to_f16((f32)(i % 400) / 64.f - 3.f);
+	}
+
+	for (usize s = 0; s < steps; s++) {
+		/* Walks a diamond, so the player stays on the map. */
+		const usize side = s / 30 % 4;
+		player.movement.x[player_slot.idx] = side == 0 || side == 3 ? 1.f : -1.f;
+		player.movement.y[player_slot.idx] = side == 0 || side == 1 ? 1.f : -1.f;
+		soa_reset_velocity(&player.velocity, player._ent.count);
+		soa_movement_to_velocity(&player.movement, &player.speed, &player.velocity, player._ent.count);
+		soa_multiply_velocity_by_future_tile_speed(&player.position, &player.velocity, player_slot, &map, tile_size, dt);
+		soa_apply_forwards_velocity(&player.position, &player.velocity, player._ent.count, dt);
+		soa_build_spatial_grid(&player.position, &player._ent, 256.f, &player_grid);
+
+		soa_follow_nearest_target(&monster.movement, &monster.position, &monster.speed, monster._ent.count,
+			&player.position, &player_grid);
+		soa_build_spatial_grid(&monster.position, &monster._ent, (f32)tile, &monster_grid);
+		soa_separate_from_neighbours(&monster.movement, &monster.position, &monster.speed, monster._ent.count,
+			&monster_grid, (f32)tile);
+		soa_move(&monster.position, &monster.velocity, &monster.movement, &monster.speed, monster._ent.count, dt);
+
+		soa_build_spatial_grid(&monster.position, &monster._ent, (f32)tile, &monster_grid);
+		soa_build_spatial_grid(&barrel.position, &barrel._ent, (f32)tile, &barrel_grid);
+		soa_fixed_test_push_apart(&contacts, &monster, &monster_grid, &monster, &monster_grid, (f32)tile, dt);
+		soa_fixed_test_push_apart(&contacts, &monster, &monster_grid, &barrel, &barrel_grid, (f32)tile, dt);
+		soa_fixed_test_push_apart(&contacts, &barrel, &barrel_grid, &barrel, &barrel_grid, (f32)tile, dt);
+		soa_fixed_test_push_apart(&contacts, &player, &player_grid, &monster, &monster_grid, (f32)tile, dt);
+		soa_fixed_test_push_apart(&contacts, &player, &player_grid, &barrel, &barrel_grid, (f32)tile, dt);
+		soa_apply_knockback(&monster.position, &monster.knockback, monster._ent.count, 8.f, dt);
+		soa_apply_knockback(&barrel.position, &barrel.knockback, barrel._ent.count, 8.f, dt);
+
+		soa_forward_movement_from_rotation(&bullet.movement, &bullet.rotation, bullet._ent.count);
+		soa_move(&bullet.position, &bullet.velocity, &bullet.movement, &bullet.speed, bullet._ent.count, dt);
+	}
+
+	const soa_position2 *positions[4] = { &player.position, &monster.position, &barrel.position, &bullet.position };
+	const usize counts[4] = { player._ent.count, monster._ent.count, barrel._ent.count, bullet._ent.count };
+	u64 hash = 14695981039346656037ull;
+	for (usize i = 0; i < 4; i++) {
+		static q16 fixed_x[SOA_LIMIT], fixed_y[SOA_LIMIT];
+		soa_q16_from_f32(fixed_x, positions[i]->x, counts[i]);
+		soa_q16_from_f32(fixed_y, positions[i]->y, counts[i]);
+		hash = soa_q16_hash(hash, fixed_x, counts[i]);
+		hash = soa_q16_hash(hash, fixed_y, counts[i]);
+	}
+	EXPECT_EQ(0xf4ac6523e4bc2b00ull, hash);
+}
+#endif
+
 UTEST_MAIN();